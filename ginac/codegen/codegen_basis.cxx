@@ -1,6 +1,8 @@
 #include <modal_basis.h>
+#include <algorithm>
 #include <iostream>
 #include <fstream>
+#include <sstream>
 #include <gkyl_util.h>
 #include <string>
 
@@ -331,6 +333,385 @@ gen_flip_even_sign(Gkyl::ModalBasisType type,
   fc << "}" << std::endl << std::endl;  
 }
 
+// Generates function that restricts the expansion to the two faces
+// z_dir = -1 and z_dir = +1 of the cell, returning the coefficients of
+// the (ndim-1)-dimensional expansions on each face. The parts of the
+// expansion even and odd in z_dir are projected once and shared
+// between the faces. For ndim = 1 the faces are points and a single
+// value is returned. Generated function signature:
+//
+// static void foo(int dir, const double *f, double *fl, double *fr)
+//
+// fl: coefficients on the face z_dir = -1
+// fr: coefficients on the face z_dir = +1
+//
+// Restrict keyword and CUDA attributes are also added
+//
+// fh: header file
+// fc: C file
+//
+static void
+gen_surf_restrict(Gkyl::ModalBasisType type,
+  std::ostream& fh, std::ostream& fc, const Gkyl::ModalBasis& basis)
+{
+  std::string bn;
+  bn = get_basis_name(type);
+
+  int ndim = basis.get_ndim(), polyOrder = basis.get_polyOrder();
+  int vdim = basis.get_vdim();
+
+  if (vdim == 0) {
+
+    // function declarations
+    fh << "GKYL_CU_DH void surf_restrict_" << ndim << "d_" << bn << "_" << "p" << polyOrder
+         << "(int dir, const double *GKYL_RESTRICT f, double *GKYL_RESTRICT fl, double *GKYL_RESTRICT fr );" << std::endl;
+
+    // function definition
+    fc << "GKYL_CU_DH" << std::endl;
+    fc << "void" << std::endl;
+    fc << "surf_restrict_" << ndim << "d_" << bn << "_" << "p" << polyOrder
+         << "(int dir, const double *GKYL_RESTRICT f, double *GKYL_RESTRICT fl, double *GKYL_RESTRICT fr )" << std::endl;
+  } else {
+    int cdim = ndim-vdim;
+    // function declarations
+    fh << "GKYL_CU_DH void surf_restrict_" << cdim << "x" << vdim << "v_" << bn << "_" << "p" << polyOrder
+         << "(int dir, const double *GKYL_RESTRICT f, double *GKYL_RESTRICT fl, double *GKYL_RESTRICT fr );" << std::endl;
+
+    // function definition
+    fc << "GKYL_CU_DH" << std::endl;
+    fc << "void" << std::endl;
+    fc << "surf_restrict_" << cdim << "x" << vdim << "v_" << bn << "_" << "p" << polyOrder
+         << "(int dir, const double *GKYL_RESTRICT f, double *GKYL_RESTRICT fl, double *GKYL_RESTRICT fr )" << std::endl;
+  }
+  fc << "{" << std::endl;
+
+  lst vars = basis.get_vars();
+  symbol f("f");
+  auto f_expand = basis.expand(f);
+
+  for (int d=0; d<ndim; ++d) {
+    exmap mr; mr[vars[d]] = 1;
+    exmap ml; ml[vars[d]] = -1;
+    auto fe = ((f_expand.subs(mr)+f_expand.subs(ml))/2).expand();
+    auto fo = ((f_expand.subs(mr)-f_expand.subs(ml))/2).expand();
+
+    fc << "  if (dir == " << d << ") {" << std::endl;
+    if (ndim == 1) {
+      fc << "    const double e = " << csrc << fe.evalf() << ";" << std::endl;
+      fc << "    const double o = " << csrc << fo.evalf() << ";" << std::endl;
+      fc << "    fl[0] = e-o; fr[0] = e+o;" << std::endl;
+    }
+    else {
+      Gkyl::ModalBasis sbasis = basis.surfBasis(d);
+      lst sbc = sbasis.get_basis();
+      for (int k=0; k<sbasis.get_numbasis(); ++k) {
+        auto ek = sbasis.innerProd(sbc[k], fe).expand().evalf();
+        auto ok = sbasis.innerProd(sbc[k], fo).expand().evalf();
+        if (ok.is_zero()) {
+          fc << "    fl[" << k << "] = " << csrc << ek << ";" << std::endl;
+          fc << "    fr[" << k << "] = fl[" << k << "];" << std::endl;
+        }
+        else if (ek.is_zero()) {
+          fc << "    fr[" << k << "] = " << csrc << ok << ";" << std::endl;
+          fc << "    fl[" << k << "] = -fr[" << k << "];" << std::endl;
+        }
+        else {
+          fc << "    { const double e = " << csrc << ek << ";" << std::endl;
+          fc << "      const double o = " << csrc << ok << ";" << std::endl;
+          fc << "      fl[" << k << "] = e-o; fr[" << k << "] = e+o; }" << std::endl;
+        }
+      }
+    }
+    fc << "  }" << std::endl;
+  }
+
+  // close function
+  fc << "}" << std::endl << std::endl;
+}
+
+// Generates function that lifts numerical fluxes on the two faces
+// z_dir = -1 and z_dir = +1 of the cell into the volume
+// coefficients, accumulating the surface term of the DG update:
+//
+// out_i += fac*( <b_i(z_dir=-1), ghat_l> - <b_i(z_dir=+1), ghat_r> )
+//
+// The fluxes are expansions in the (ndim-1)-dimensional surface
+// basis. The face sum and difference of the fluxes are formed once and
+// the basis restriction is split into its even and odd parts, so the
+// output cell is updated in a single pass. Generated function
+// signature:
+//
+// static void foo(int dir, double fac, const double *ghat_l, const double *ghat_r, double *out)
+//
+// Restrict keyword and CUDA attributes are also added
+//
+// fh: header file
+// fc: C file
+//
+static void
+gen_surf_lift(Gkyl::ModalBasisType type,
+  std::ostream& fh, std::ostream& fc, const Gkyl::ModalBasis& basis)
+{
+  std::string bn;
+  bn = get_basis_name(type);
+
+  int ndim = basis.get_ndim(), polyOrder = basis.get_polyOrder();
+  int vdim = basis.get_vdim();
+
+  if (vdim == 0) {
+
+    // function declarations
+    fh << "GKYL_CU_DH void surf_lift_" << ndim << "d_" << bn << "_" << "p" << polyOrder
+         << "(int dir, double fac, const double *GKYL_RESTRICT ghat_l, const double *GKYL_RESTRICT ghat_r, double *GKYL_RESTRICT out );" << std::endl;
+
+    // function definition
+    fc << "GKYL_CU_DH" << std::endl;
+    fc << "void" << std::endl;
+    fc << "surf_lift_" << ndim << "d_" << bn << "_" << "p" << polyOrder
+         << "(int dir, double fac, const double *GKYL_RESTRICT ghat_l, const double *GKYL_RESTRICT ghat_r, double *GKYL_RESTRICT out )" << std::endl;
+  } else {
+    int cdim = ndim-vdim;
+    // function declarations
+    fh << "GKYL_CU_DH void surf_lift_" << cdim << "x" << vdim << "v_" << bn << "_" << "p" << polyOrder
+         << "(int dir, double fac, const double *GKYL_RESTRICT ghat_l, const double *GKYL_RESTRICT ghat_r, double *GKYL_RESTRICT out );" << std::endl;
+
+    // function definition
+    fc << "GKYL_CU_DH" << std::endl;
+    fc << "void" << std::endl;
+    fc << "surf_lift_" << cdim << "x" << vdim << "v_" << bn << "_" << "p" << polyOrder
+         << "(int dir, double fac, const double *GKYL_RESTRICT ghat_l, const double *GKYL_RESTRICT ghat_r, double *GKYL_RESTRICT out )" << std::endl;
+  }
+  fc << "{" << std::endl;
+
+  lst vars = basis.get_vars(), bc = basis.get_basis();
+  // s = fac*(ghat_l-ghat_r) multiplies the even part of the restricted
+  // basis, t = fac*(ghat_l+ghat_r) the odd part
+  symbol s("s"), t("t");
+
+  for (int d=0; d<ndim; ++d) {
+    exmap mr; mr[vars[d]] = 1;
+    exmap ml; ml[vars[d]] = -1;
+
+    fc << "  if (dir == " << d << ") {" << std::endl;
+    if (ndim == 1) {
+      fc << "    const double s[1] = { fac*(ghat_l[0]-ghat_r[0]) };" << std::endl;
+      fc << "    const double t[1] = { fac*(ghat_l[0]+ghat_r[0]) };" << std::endl;
+      for (int i=0; i<basis.get_numbasis(); ++i) {
+        auto be = ((bc[i].subs(mr)+bc[i].subs(ml))/2).expand();
+        auto bo = ((bc[i].subs(mr)-bc[i].subs(ml))/2).expand();
+        auto out = (be*indexed(s, idx(0,1)) - bo*indexed(t, idx(0,1))).evalf();
+        fc << "    out[" << i << "] += " << csrc << out << ";" << std::endl;
+      }
+    }
+    else {
+      Gkyl::ModalBasis sbasis = basis.surfBasis(d);
+      int nsurf = sbasis.get_numbasis();
+      fc << "    double s[" << nsurf << "], t[" << nsurf << "];" << std::endl;
+      fc << "    for (int k=0; k<" << nsurf << "; ++k) {" << std::endl;
+      fc << "      s[k] = fac*(ghat_l[k]-ghat_r[k]);" << std::endl;
+      fc << "      t[k] = fac*(ghat_l[k]+ghat_r[k]);" << std::endl;
+      fc << "    }" << std::endl;
+      auto s_expand = sbasis.expand(s), t_expand = sbasis.expand(t);
+      for (int i=0; i<basis.get_numbasis(); ++i) {
+        auto be = ((bc[i].subs(mr)+bc[i].subs(ml))/2).expand();
+        auto bo = ((bc[i].subs(mr)-bc[i].subs(ml))/2).expand();
+        auto out = (sbasis.innerProd(be, s_expand) - sbasis.innerProd(bo, t_expand)).expand().evalf();
+        if (!out.is_zero())
+          fc << "    out[" << i << "] += " << csrc << out << ";" << std::endl;
+      }
+    }
+    fc << "  }" << std::endl;
+  }
+
+  // close function
+  fc << "}" << std::endl << std::endl;
+}
+
+// Generates functions transferring an expansion between polynomial
+// orders q < p of the same basis family. With T_jk = < b^p_j, b^q_k >,
+// prolongation is f^p = T.f^q and restriction (the L2 projection onto
+// the order q basis) is f^q = T^T.f^p. Since the order q space is
+// contained in the order p space and both bases are orthonormal, T is
+// mostly a truncated identity and only its non-zero entries are
+// written. Generated function signatures:
+//
+// static void prolong_foo_p{q}_to_p{p}(const double *f, double *fout)
+// static void restrict_foo_p{p}_to_p{q}(const double *f, double *fout)
+//
+// Restrict keyword and CUDA attributes are also added
+//
+// fh: header file
+// fc: C file
+//
+static void
+gen_order_transfer(Gkyl::ModalBasisType type, std::ostream& fh, std::ostream& fc,
+  const Gkyl::ModalBasis& basis, const Gkyl::ModalBasis& qbasis)
+{
+  std::string bn = get_basis_name(type);
+  int ndim = basis.get_ndim(), p = basis.get_polyOrder(), q = qbasis.get_polyOrder();
+  int np = basis.get_numbasis(), nq = qbasis.get_numbasis();
+
+  std::ostringstream pn, rn;
+  pn << "prolong_" << ndim << "d_" << bn << "_p" << q << "_to_p" << p;
+  rn << "restrict_" << ndim << "d_" << bn << "_p" << p << "_to_p" << q;
+
+  // function declarations
+  fh << "GKYL_CU_DH void " << pn.str() << "(const double *GKYL_RESTRICT f, double *GKYL_RESTRICT fout);" << std::endl;
+  fh << "GKYL_CU_DH void " << rn.str() << "(const double *GKYL_RESTRICT f, double *GKYL_RESTRICT fout);" << std::endl;
+
+  lst bq = qbasis.get_basis();
+  std::vector<lst> T;
+  for (int k=0; k<nq; ++k)
+    T.push_back(basis.project(bq[k]));
+
+  symbol f("f");
+  fc << "GKYL_CU_DH" << std::endl;
+  fc << "void" << std::endl;
+  fc << pn.str() << "(const double *GKYL_RESTRICT f, double *GKYL_RESTRICT fout)" << std::endl;
+  fc << "{" << std::endl;
+  for (int j=0; j<np; ++j) {
+    ex fj = 0;
+    for (int k=0; k<nq; ++k)
+      fj += T[k][j]*indexed(f, idx(k,1));
+    fc << "  fout[" << j << "] = " << csrc << fj.evalf() << ";" << std::endl;
+  }
+  fc << "}" << std::endl << std::endl;
+
+  fc << "GKYL_CU_DH" << std::endl;
+  fc << "void" << std::endl;
+  fc << rn.str() << "(const double *GKYL_RESTRICT f, double *GKYL_RESTRICT fout)" << std::endl;
+  fc << "{" << std::endl;
+  for (int k=0; k<nq; ++k) {
+    ex fk = 0;
+    for (int j=0; j<np; ++j)
+      fk += T[k][j]*indexed(f, idx(j,1));
+    fc << "  fout[" << k << "] = " << csrc << fk.evalf() << ";" << std::endl;
+  }
+  fc << "}" << std::endl << std::endl;
+}
+
+// Binomial coefficient n choose k
+static int
+binomial_coeff(int n, int k)
+{
+  int c = 1;
+  for (int j=1; j<=k; ++j)
+    c = c*(n-k+j)/j;
+  return c;
+}
+
+// Generates functions converting the expansion to the tensor-product
+// Bernstein form on the cell, with degree n_d in direction d equal to
+// the highest degree of the basis in that direction. Under z = 2t-1
+// the expansion is written in monomials t^b, and the Bernstein
+// coefficients are
+//
+//   c_i = sum_{b<=i} prod_d C(i_d,b_d)/C(n_d,b_d) a_b
+//
+// By the convex-hull property min_i c_i <= f <= max_i c_i over the
+// whole cell, so unlike sampling at nodes this gives rigorous
+// bounds. The coefficients are stored with direction 0 slowest. The
+// bounds kernel does not store them and returns bounds[0] = min c_i
+// and bounds[1] = max c_i. Generated function signatures:
+//
+// static void modal_to_bernstein_foo(const double *f, double *bern)
+// static void bernstein_bounds_foo(const double *f, double *bounds)
+//
+// Restrict keyword and CUDA attributes are also added
+//
+// fh: header file
+// fc: C file
+//
+static void
+gen_bernstein(Gkyl::ModalBasisType type, std::ostream& fh, std::ostream& fc, const Gkyl::ModalBasis& basis)
+{
+  std::string bn = get_basis_name(type);
+  int ndim = basis.get_ndim(), polyOrder = basis.get_polyOrder();
+
+  std::ostringstream cn, bd;
+  cn << "modal_to_bernstein_" << ndim << "d_" << bn << "_p" << polyOrder;
+  bd << "bernstein_bounds_" << ndim << "d_" << bn << "_p" << polyOrder;
+
+  // function declarations
+  fh << "GKYL_CU_DH void " << cn.str() << "(const double *GKYL_RESTRICT f, double *GKYL_RESTRICT bern);" << std::endl;
+  fh << "GKYL_CU_DH void " << bd.str() << "(const double *GKYL_RESTRICT f, double *GKYL_RESTRICT bounds);" << std::endl;
+
+  // degree in each direction
+  lst mo = basis.get_monomials();
+  std::vector<int> deg(ndim, 0);
+  int ncoeff = 1;
+  for (int d=0; d<ndim; ++d) {
+    for (size_t m=0; m<mo.nops(); ++m)
+      deg[d] = std::max(deg[d], mo[m].degree(basis.get_var(d)));
+    ncoeff *= deg[d]+1;
+  }
+
+  // expansion in monomials of t = (z+1)/2
+  std::vector<symbol> tv;
+  exmap zt;
+  for (int d=0; d<ndim; ++d) {
+    std::ostringstream tn;
+    tn << "t" << d;
+    tv.push_back(symbol(tn.str()));
+    zt[basis.get_var(d)] = 2*tv[d]-1;
+  }
+  symbol f("f");
+  ex ft = basis.expand(f).subs(zt).expand();
+
+  // multi-index of coefficient m, direction 0 slowest
+  std::vector<std::vector<int> > mi(ncoeff, std::vector<int>(ndim));
+  for (int m=0; m<ncoeff; ++m)
+    for (int d=ndim-1, r=m; d>=0; --d) {
+      mi[m][d] = r % (deg[d]+1);
+      r /= deg[d]+1;
+    }
+
+  std::vector<ex> a(ncoeff);
+  for (int m=0; m<ncoeff; ++m) {
+    a[m] = ft;
+    for (int d=0; d<ndim; ++d)
+      a[m] = a[m].coeff(tv[d], mi[m][d]);
+  }
+
+  std::vector<ex> c(ncoeff);
+  for (int i=0; i<ncoeff; ++i) {
+    c[i] = 0;
+    for (int b=0; b<ncoeff; ++b) {
+      ex w = 1;
+      for (int d=0; d<ndim && w != 0; ++d) {
+        if (mi[b][d] > mi[i][d])
+          w = 0;
+        else
+          w *= numeric(binomial_coeff(mi[i][d], mi[b][d]), binomial_coeff(deg[d], mi[b][d]));
+      }
+      c[i] += w*a[b];
+    }
+    c[i] = c[i].expand().evalf();
+  }
+
+  fc << "GKYL_CU_DH" << std::endl;
+  fc << "void" << std::endl;
+  fc << cn.str() << "(const double *GKYL_RESTRICT f, double *GKYL_RESTRICT bern)" << std::endl;
+  fc << "{" << std::endl;
+  for (int i=0; i<ncoeff; ++i)
+    fc << "  bern[" << i << "] = " << csrc << c[i] << ";" << std::endl;
+  fc << "}" << std::endl << std::endl;
+
+  fc << "GKYL_CU_DH" << std::endl;
+  fc << "void" << std::endl;
+  fc << bd.str() << "(const double *GKYL_RESTRICT f, double *GKYL_RESTRICT bounds)" << std::endl;
+  fc << "{" << std::endl;
+  fc << "  double c = " << csrc << c[0] << ";" << std::endl;
+  fc << "  double cmin = c, cmax = c;" << std::endl;
+  for (int i=1; i<ncoeff; ++i) {
+    fc << "  c = " << csrc << c[i] << ";" << std::endl;
+    fc << "  cmin = fmin(cmin, c); cmax = fmax(cmax, c);" << std::endl;
+  }
+  fc << "  bounds[0] = cmin;" << std::endl;
+  fc << "  bounds[1] = cmax;" << std::endl;
+  fc << "}" << std::endl << std::endl;
+}
+
 static void
 gen_node_coords(Gkyl::ModalBasisType type, std::ostream& fh, std::ostream& fc, const Gkyl::ModalBasis& basis)
 {
@@ -403,6 +784,9 @@ gen_ser_basis()
   
   std::ofstream eval_file("kernels/basis/basis_eval_ser.c", std::ofstream::out);
   std::ofstream flip_file("kernels/basis/basis_flip_sign_ser.c", std::ofstream::out);
+  std::ofstream surf_file("kernels/basis/basis_surf_ser.c", std::ofstream::out);
+  std::ofstream order_file("kernels/basis/basis_order_transfer_ser.c", std::ofstream::out);
+  std::ofstream bern_file("kernels/basis/basis_bernstein_ser.c", std::ofstream::out);
 
   eval_file << "// " << buff << std::endl;
   eval_file << "#include <gkyl_basis_ser_kernels.h>" << std::endl;
@@ -410,6 +794,16 @@ gen_ser_basis()
   flip_file << "// " << buff << std::endl;
   flip_file << "#include <gkyl_basis_ser_kernels.h>" << std::endl;
 
+  surf_file << "// " << buff << std::endl;
+  surf_file << "#include <gkyl_basis_ser_kernels.h>" << std::endl;
+
+  order_file << "// " << buff << std::endl;
+  order_file << "#include <gkyl_basis_ser_kernels.h>" << std::endl;
+
+  bern_file << "// " << buff << std::endl;
+  bern_file << "#include <math.h>" << std::endl;
+  bern_file << "#include <gkyl_basis_ser_kernels.h>" << std::endl;
+
   for (int d=0; d<6; ++d) {
     int dim = dims[d];
     for (int p=0; p<=max_order[d]; ++p) {
@@ -428,6 +822,18 @@ gen_ser_basis()
       gen_node_coords(Gkyl::MODAL_SER, header, flip_file, mbasis);
       // generate nodal to modal
       gen_nodal_to_modal(Gkyl::MODAL_SER, header, flip_file, mbasis);
+      // generate surface restriction
+      gen_surf_restrict(Gkyl::MODAL_SER, header, surf_file, mbasis);
+      // generate lift of surface fluxes to volume
+      gen_surf_lift(Gkyl::MODAL_SER, header, surf_file, mbasis);
+      // generate transfer from/to lower orders
+      for (int q=0; q<p; ++q) {
+        Gkyl::ModalBasis qbasis(Gkyl::MODAL_SER, dim, 0, vars, q);
+        gen_order_transfer(Gkyl::MODAL_SER, header, order_file, mbasis, qbasis);
+      }
+      // generate Bernstein coefficients and bounds
+      if (dim <= 3 && p >= 1)
+        gen_bernstein(Gkyl::MODAL_SER, header, bern_file, mbasis);
     }
     std::cout << std::endl;
   }
@@ -457,6 +863,7 @@ gen_hyb_basis()
   
   std::ofstream eval_file("kernels/basis/basis_eval_hyb.c", std::ofstream::out);
   std::ofstream flip_file("kernels/basis/basis_flip_sign_hyb.c", std::ofstream::out);
+  std::ofstream surf_file("kernels/basis/basis_surf_hyb.c", std::ofstream::out);
 
   eval_file << "// " << buff << std::endl;
   eval_file << "#include <gkyl_basis_hyb_kernels.h>" << std::endl;
@@ -464,6 +871,9 @@ gen_hyb_basis()
   flip_file << "// " << buff << std::endl;
   flip_file << "#include <gkyl_basis_hyb_kernels.h>" << std::endl;
 
+  surf_file << "// " << buff << std::endl;
+  surf_file << "#include <gkyl_basis_hyb_kernels.h>" << std::endl;
+
   // All dim combinations needed when one accounts for surface 
   // evaluation, GK and sims that are only kinetic in 1 v-space dir.
   for (int cd=1; cd<4; ++cd) {
@@ -485,6 +895,10 @@ gen_hyb_basis()
       gen_node_coords(Gkyl::MODAL_HYB, header, flip_file, mbasis);
       // generate nodal to modal
       gen_nodal_to_modal(Gkyl::MODAL_HYB, header, flip_file, mbasis);
+      // generate surface restriction
+      gen_surf_restrict(Gkyl::MODAL_HYB, header, surf_file, mbasis);
+      // generate lift of surface fluxes to volume
+      gen_surf_lift(Gkyl::MODAL_HYB, header, surf_file, mbasis);
       std::cout << std::endl;
     }
   }
@@ -514,6 +928,7 @@ gen_gkhyb_basis()
   
   std::ofstream eval_file("kernels/basis/basis_eval_gkhyb.c", std::ofstream::out);
   std::ofstream flip_file("kernels/basis/basis_flip_sign_gkhyb.c", std::ofstream::out);
+  std::ofstream surf_file("kernels/basis/basis_surf_gkhyb.c", std::ofstream::out);
 
   eval_file << "// " << buff << std::endl;
   eval_file << "#include <gkyl_basis_gkhyb_kernels.h>" << std::endl;
@@ -521,6 +936,9 @@ gen_gkhyb_basis()
   flip_file << "// " << buff << std::endl;
   flip_file << "#include <gkyl_basis_gkhyb_kernels.h>" << std::endl;
 
+  surf_file << "// " << buff << std::endl;
+  surf_file << "#include <gkyl_basis_gkhyb_kernels.h>" << std::endl;
+
   for (int cd=1; cd<4; ++cd) {
     for (int vd=std::min(cd,2); vd<3; ++vd) {
       int dim = cd+vd;
@@ -540,6 +958,10 @@ gen_gkhyb_basis()
       gen_node_coords(Gkyl::MODAL_GKHYB, header, flip_file, mbasis);
       // generate nodal to modal
       gen_nodal_to_modal(Gkyl::MODAL_GKHYB, header, flip_file, mbasis);
+      // generate surface restriction
+      gen_surf_restrict(Gkyl::MODAL_GKHYB, header, surf_file, mbasis);
+      // generate lift of surface fluxes to volume
+      gen_surf_lift(Gkyl::MODAL_GKHYB, header, surf_file, mbasis);
       std::cout << std::endl;
     }
   }
@@ -569,6 +991,9 @@ gen_ten_basis()
   
   std::ofstream eval_file("kernels/basis/basis_eval_tensor.c", std::ofstream::out);
   std::ofstream flip_file("kernels/basis/basis_flip_sign_tensor.c", std::ofstream::out);
+  std::ofstream surf_file("kernels/basis/basis_surf_tensor.c", std::ofstream::out);
+  std::ofstream order_file("kernels/basis/basis_order_transfer_tensor.c", std::ofstream::out);
+  std::ofstream bern_file("kernels/basis/basis_bernstein_tensor.c", std::ofstream::out);
 
   eval_file << "// " << buff << std::endl;
   eval_file << "#include <gkyl_basis_tensor_kernels.h>" << std::endl;
@@ -576,6 +1001,16 @@ gen_ten_basis()
   flip_file << "// " << buff << std::endl;
   flip_file << "#include <gkyl_basis_tensor_kernels.h>" << std::endl;
 
+  surf_file << "// " << buff << std::endl;
+  surf_file << "#include <gkyl_basis_tensor_kernels.h>" << std::endl;
+
+  order_file << "// " << buff << std::endl;
+  order_file << "#include <gkyl_basis_tensor_kernels.h>" << std::endl;
+
+  bern_file << "// " << buff << std::endl;
+  bern_file << "#include <math.h>" << std::endl;
+  bern_file << "#include <gkyl_basis_tensor_kernels.h>" << std::endl;
+
   for (int d=0; d<4; ++d) {
     int dim = dims[d];
     for (int p=2; p<=max_order[d]; ++p) {
@@ -594,9 +1029,30 @@ gen_ten_basis()
       gen_node_coords(Gkyl::MODAL_TEN, header, flip_file, mbasis);
       // generate nodal to modal
       gen_nodal_to_modal(Gkyl::MODAL_TEN, header, flip_file, mbasis);
+      // generate surface restriction
+      gen_surf_restrict(Gkyl::MODAL_TEN, header, surf_file, mbasis);
+      // generate lift of surface fluxes to volume
+      gen_surf_lift(Gkyl::MODAL_TEN, header, surf_file, mbasis);
+      // generate transfer from/to lower orders (p0 and p1 tensor
+      // bases are the serendipity ones)
+      for (int q=0; q<p; ++q) {
+        Gkyl::ModalBasis qbasis(Gkyl::MODAL_TEN, dim, 0, vars, q);
+        gen_order_transfer(Gkyl::MODAL_TEN, header, order_file, mbasis, qbasis);
+      }
+      // generate Bernstein coefficients and bounds
+      if (dim <= 3)
+        gen_bernstein(Gkyl::MODAL_TEN, header, bern_file, mbasis);
     }
     std::cout << std::endl;
   }
+
+  // Bernstein bounds are also needed for the p3 tensor bases in 2D and
+  // 3D, which have no other kernels
+  for (int dim=2; dim<=3; ++dim) {
+    std::cout << dim << "dp3 " << std::endl;
+    Gkyl::ModalBasis mbasis(Gkyl::MODAL_TEN, dim, 0, vars, 3);
+    gen_bernstein(Gkyl::MODAL_TEN, header, bern_file, mbasis);
+  }
   header << "EXTERN_C_END" << std::endl;
 }
 
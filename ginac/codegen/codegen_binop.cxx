@@ -1,4 +1,5 @@
 #include <modal_basis.h>
+#include <kernel_util.h>
 #include <iostream>
 #include <fstream>
 #include <sstream>
@@ -18,61 +19,124 @@ total_op(const ex& expr)
   return count;
 }
 
+// Computes projection of the product of expansions in basis ba and
+// bb onto basis bb. Returns list with one expression per basis
+// function of bb.
+static lst
+calc_mul_proj(const Gkyl::ModalBasis& ba, const Gkyl::ModalBasis& bb)
+{
+  lst bc = bb.get_basis(); // projection is on basis function bb
+
+  symbol f("f"), g("g");
+  auto fg = ba.expand(f)*bb.expand(g);
+
+  lst out;
+  for (int i=0; i<bb.get_numbasis(); ++i) {
+    std::cout << i << " " << std::flush;
+    out.append( bb.innerProd(bc[i], fg).expand().evalf() );
+  }
+  std::cout << std::endl;
+  return out;
+}
+
+// Generates the restrict and accumulate variants of a multiplication
+// kernel named 'name'. Generated function signatures:
+//
+// void name_restrict(const double *f, const double *g, double *fg)
+// void name_acc(double a, const double *f, const double *g, double *out)
+//
+// The restrict variant writes directly into fg, without the tmp
+// buffer, and so fg must not alias f or g. The acc variant computes
+// out += a*proj(f*g) in a single pass and out must not alias f or g.
+//
+// fh: header file
+// fc: C file
+// fg: projected product, one expression per output coefficient
+//
+static void
+gen_mul_variants(std::ostream& fh, std::ostream& fc, const std::string& name, const lst& fg)
+{
+  // function declarations
+  fh << "GKYL_CU_DH void " << name << "_restrict"
+     << "(const double *GKYL_RESTRICT f, const double *GKYL_RESTRICT g, double *GKYL_RESTRICT fg );" << std::endl;
+  fh << "GKYL_CU_DH void " << name << "_acc"
+     << "(double a, const double *GKYL_RESTRICT f, const double *GKYL_RESTRICT g, double *GKYL_RESTRICT out );" << std::endl;
+
+  // restrict variant
+  fc << std::endl;
+  fc << "GKYL_CU_DH" << std::endl;
+  fc << "void" << std::endl;
+  fc << name << "_restrict"
+     << "(const double *GKYL_RESTRICT f, const double *GKYL_RESTRICT g, double *GKYL_RESTRICT fg )" << std::endl;
+  fc << "{" << std::endl;
+  for (int i=0; i<fg.nops(); ++i)
+    fc << "  fg[" << i << "] = " << csrc << fg[i] << ";" << std::endl;
+  fc << "}" << std::endl << std::endl;
+
+  // accumulate variant
+  fc << "GKYL_CU_DH" << std::endl;
+  fc << "void" << std::endl;
+  fc << name << "_acc"
+     << "(double a, const double *GKYL_RESTRICT f, const double *GKYL_RESTRICT g, double *GKYL_RESTRICT out )" << std::endl;
+  fc << "{" << std::endl;
+  for (int i=0; i<fg.nops(); ++i)
+    if (!fg[i].is_zero())
+      fc << "  out[" << i << "] += a*(" << csrc << fg[i] << ");" << std::endl;
+  fc << "}" << std::endl;
+}
+
 static void
 gen_ser_mul_op(std::ostream& fh, std::ostream& fc, const Gkyl::ModalBasis& basis)
 {
   int ndim = basis.get_ndim(), polyOrder = basis.get_polyOrder();
-  lst bc = basis.get_basis();
+
+  std::ostringstream kn;
+  kn << "binop_mul_" << ndim << "d_ser_" << "p" << polyOrder;
   
   // function declaration
   fh << std::endl
-     << "GKYL_CU_DH void binop_mul_" << ndim << "d_ser_" << "p" << polyOrder
+     << "GKYL_CU_DH void " << kn.str()
      << "(const double *f, const double *g, double *fg );" << std::endl;
 
   // declare function returning op counts
-  fh << "struct gkyl_kern_op_count op_count_binop_mul_" << ndim << "d_ser_" << "p" << polyOrder
+  fh << "struct gkyl_kern_op_count op_count_" << kn.str()
      << "(void);" << std::endl;
 
   // function definition
   fc << "GKYL_CU_DH" << std::endl;
   fc << "void" << std::endl;
-  fc << "binop_mul_" << ndim << "d_ser_" << "p" << polyOrder
+  fc << kn.str()
        << "(const double *f, const double *g, double *fg )" << std::endl;
   fc << "{" << std::endl;  
   fc << "  double tmp[" << basis.get_numbasis() << "] = {0.};" << std::endl;
 
   int nsum = 0, nprod = 0;
-  symbol f("f"), g("g");
-  auto fg = basis.expand(f)*basis.expand(g);
+  lst fg = calc_mul_proj(basis, basis);
 
   for (int i=0; i<basis.get_numbasis(); ++i) {
-    std::cout << i << " " << std::flush;
-    auto out = basis.innerProd(bc[i], fg).expand().evalf();
-    fc << "  tmp[" << i << "] = " << csrc << out << ";" << std::endl;
-    struct gkyl_kern_op_count count = total_op(out);
+    fc << "  tmp[" << i << "] = " << csrc << fg[i] << ";" << std::endl;
+    struct gkyl_kern_op_count count = total_op(fg[i]);
     nsum += count.num_sum;
     nprod += count.num_prod;
   }
-  std::cout << std::endl;
   fc << " " << std::endl;
 
-  for (int i=0; i<basis.get_numbasis(); ++i) {
-    std::cout << i << " " << std::flush;
+  for (int i=0; i<basis.get_numbasis(); ++i)
     fc << "  fg[" << i << "] = tmp[" << i << "];" << std::endl;
-  }
-  std::cout << std::endl;
 
   fc << "  // nsum = " << nsum << ", nprod = " << nprod << std::endl;
   // close function
   fc << "}" << std::endl << std::endl;
 
   // write out function to return op counts
-  fc << "struct gkyl_kern_op_count op_count_binop_mul_" << ndim << "d_ser_" << "p" << polyOrder
+  fc << "struct gkyl_kern_op_count op_count_" << kn.str()
      << "(void)" << std::endl;
   fc << "{" << std::endl;
   fc << "  return (struct gkyl_kern_op_count) { .num_sum = " << nsum << ", .num_prod = " << nprod
      << " };" << std::endl;
   fc << "}" << std::endl;
+
+  gen_mul_variants(fh, fc, kn.str(), fg);
 }
 
 static void
@@ -83,42 +147,35 @@ gen_ser_cross_mul_op(std::ostream& fh, std::ostream& fc,
   int a_ndim = ba.get_ndim();
   int b_ndim = bb.get_ndim();
   
-  lst bc = bb.get_basis(); // projection is on basis function bb
+  std::ostringstream kn;
+  kn << "binop_cross_mul_" << a_ndim << "d_" << b_ndim << "d_ser_" << "p" << polyOrder;
   
   // function declaration
   fh << std::endl
-     << "GKYL_CU_DH void binop_cross_mul_" << a_ndim << "d_" << b_ndim << "d_ser_" << "p" << polyOrder
+     << "GKYL_CU_DH void " << kn.str()
      << "(const double *f, const double *g, double *fg );" << std::endl;
 
   // function definition
   fc << "GKYL_CU_DH" << std::endl;
   fc << "void" << std::endl;
-  fc << "binop_cross_mul_" << a_ndim << "d_" << b_ndim << "d_ser_" << "p" << polyOrder
+  fc << kn.str()
        << "(const double *f, const double *g, double *fg )" << std::endl;
   fc << "{" << std::endl;
   fc << "  double tmp[" << bb.get_numbasis() << "] = {0.};" << std::endl;
 
-  symbol f("f"), g("g");
-  auto fg = ba.expand(f)*bb.expand(g);
+  lst fg = calc_mul_proj(ba, bb);
 
-  for (int i=0; i<bb.get_numbasis(); ++i) {
-    std::cout << i << " " << std::flush;
-    auto out = bb.innerProd(bc[i], fg).expand().evalf();
-    fc << "  tmp[" << i << "] = " << csrc << out << ";" << std::endl;
-  }
-  std::cout << std::endl;  
-  fc << "  double tmp[" << bb.get_numbasis() << "] = {0.};" << std::endl;
+  for (int i=0; i<bb.get_numbasis(); ++i)
+    fc << "  tmp[" << i << "] = " << csrc << fg[i] << ";" << std::endl;
   fc << " " << std::endl;
 
-  for (int i=0; i<bb.get_numbasis(); ++i) {
-    std::cout << i << " " << std::flush;
+  for (int i=0; i<bb.get_numbasis(); ++i)
     fc << "  fg[" << i << "] = " << "tmp[" << i << "];" << std::endl;
-  }
-  std::cout << std::endl;  
 
   // close function
   fc << "}" << std::endl << std::endl;
 
+  gen_mul_variants(fh, fc, kn.str(), fg);
 }
 
 static void
@@ -130,41 +187,35 @@ gen_hyb_cross_mul_op(std::ostream& fh, std::ostream& fc,
   int pdim = bb.get_ndim();
   int vdim = pdim-cdim;
   
-  lst bc = bb.get_basis(); // projection is on basis function bb
+  std::ostringstream kn;
+  kn << "binop_cross_mul_" << cdim << "x" << vdim << "v_hyb_" << "p" << polyOrder;
   
   // function declaration
   fh << std::endl
-     << "GKYL_CU_DH void binop_cross_mul_" << cdim << "x" << vdim << "v_hyb_" << "p" << polyOrder
+     << "GKYL_CU_DH void " << kn.str()
      << "(const double *f, const double *g, double *fg );" << std::endl;
 
   // function definition
   fc << "GKYL_CU_DH" << std::endl;
   fc << "void" << std::endl;
-  fc << "binop_cross_mul_" << cdim << "x" << vdim << "v_hyb_" << "p" << polyOrder
+  fc << kn.str()
        << "(const double *f, const double *g, double *fg )" << std::endl;
   fc << "{" << std::endl;
   fc << "  double tmp[" << bb.get_numbasis() << "] = {0.};" << std::endl;
 
-  symbol f("f"), g("g");
-  auto fg = ba.expand(f)*bb.expand(g);
+  lst fg = calc_mul_proj(ba, bb);
 
-  for (int i=0; i<bb.get_numbasis(); ++i) {
-    std::cout << i << " " << std::flush;
-    auto out = bb.innerProd(bc[i], fg).expand().evalf();
-    fc << "  tmp[" << i << "] = " << csrc << out << ";" << std::endl;
-  }
-  std::cout << std::endl;  
+  for (int i=0; i<bb.get_numbasis(); ++i)
+    fc << "  tmp[" << i << "] = " << csrc << fg[i] << ";" << std::endl;
   fc << " " << std::endl;
 
-  for (int i=0; i<bb.get_numbasis(); ++i) {
-    std::cout << i << " " << std::flush;
+  for (int i=0; i<bb.get_numbasis(); ++i)
     fc << "  fg[" << i << "] = " << "tmp[" << i << "];" << std::endl;
-  }
-  std::cout << std::endl;  
 
   // close function
   fc << "}" << std::endl << std::endl;
 
+  gen_mul_variants(fh, fc, kn.str(), fg);
 }
 
 static void
@@ -176,41 +227,261 @@ gen_gkhyb_cross_mul_op(std::ostream& fh, std::ostream& fc,
   int pdim = bb.get_ndim();
   int vdim = pdim - cdim;
   
-  lst bc = bb.get_basis(); // projection is on basis function bb
+  std::ostringstream kn;
+  kn << "binop_cross_mul_" << cdim << "x" << vdim << "v_gkhyb_" << "p" << polyOrder;
   
   // function declaration
   fh << std::endl
-     << "GKYL_CU_DH void binop_cross_mul_" << cdim << "x" << vdim << "v_gkhyb_" << "p" << polyOrder
+     << "GKYL_CU_DH void " << kn.str()
      << "(const double *f, const double *g, double *fg );" << std::endl;
 
   // function definition
   fc << "GKYL_CU_DH" << std::endl;
   fc << "void" << std::endl;
-  fc << "binop_cross_mul_" << cdim << "x" << vdim << "v_gkhyb_" << "p" << polyOrder
+  fc << kn.str()
        << "(const double *f, const double *g, double *fg )" << std::endl;
   fc << "{" << std::endl;
   fc << "  double tmp[" << bb.get_numbasis() << "] = {0.};" << std::endl;
 
-  symbol f("f"), g("g");
-  auto fg = ba.expand(f)*bb.expand(g);
+  lst fg = calc_mul_proj(ba, bb);
 
-  for (int i=0; i<bb.get_numbasis(); ++i) {
-    std::cout << i << " " << std::flush;
-    auto out = bb.innerProd(bc[i], fg).expand().evalf();
-    fc << "  tmp[" << i << "] = " << csrc << out << ";" << std::endl;
-  }
-  std::cout << std::endl;  
+  for (int i=0; i<bb.get_numbasis(); ++i)
+    fc << "  tmp[" << i << "] = " << csrc << fg[i] << ";" << std::endl;
   fc << " " << std::endl;
 
-  for (int i=0; i<bb.get_numbasis(); ++i) {
-    std::cout << i << " " << std::flush;
+  for (int i=0; i<bb.get_numbasis(); ++i)
     fc << "  fg[" << i << "] = " << "tmp[" << i << "];" << std::endl;
+
+  // close function
+  fc << "}" << std::endl << std::endl;
+
+  gen_mul_variants(fh, fc, kn.str(), fg);
+}
+
+// Generates multiplication kernel using quadrature instead of the
+// modal triple-product tensor: f and g are evaluated at the nodes of a
+// tensor Gauss-Legendre rule, multiplied pointwise and the product is
+// projected back on the basis. With n = floor(3*deg/2)+1 points per
+// direction, where deg is the highest degree of the basis in any
+// direction, the rule is exact for f*g*b_k and the result matches the
+// modal kernel. Evaluation and projection are sum-factorized, so the
+// cost grows like n^(ndim+1) rather than with the number of nonzeros
+// of the triple-product tensor, which is dense in high dimensions.
+// Generated function signature:
+//
+// void foo(const double *f, const double *g, double *fg)
+//
+// fg can alias f or g.
+//
+// fh: header file
+// fc: C file
+//
+static void
+gen_mul_quad_op(std::ostream& fh, std::ostream& fc, const std::string& bn, const Gkyl::ModalBasis& basis)
+{
+  int ndim = basis.get_ndim(), polyOrder = basis.get_polyOrder();
+  lst bc = basis.get_basis();
+
+  int deg = 0;
+  for (int k=0; k<basis.get_numbasis(); ++k)
+    for (int d=0; d<ndim; ++d)
+      deg = std::max(deg, bc[k].degree(basis.get_var(d)));
+  int n = 3*deg/2+1, nq = 1;
+  for (int d=0; d<ndim; ++d) nq *= n;
+
+  std::ostringstream kn;
+  kn << "binop_mul_quad_" << ndim << "d_" << bn << "_p" << polyOrder;
+
+  // function declaration
+  fh << std::endl
+     << "GKYL_CU_DH void " << kn.str()
+     << "(const double *f, const double *g, double *fg );" << std::endl;
+
+  // function definition
+  fc << "GKYL_CU_DH" << std::endl;
+  fc << "void" << std::endl;
+  fc << kn.str()
+     << "(const double *f, const double *g, double *fg )" << std::endl;
+  fc << "{" << std::endl;
+  fc << "  double fq[" << nq << "], gq[" << nq << "];" << std::endl;
+
+  struct gkyl_kern_op_count count = { 0 };
+  count = Gkyl::addOps(count, Gkyl::writeQuadEval(fc, "  ", basis, n, "f", "fq"));
+  count = Gkyl::addOps(count, Gkyl::writeQuadEval(fc, "  ", basis, n, "g", "gq"));
+  fc << std::endl;
+
+  fc << "  for (int q=0; q<" << nq << "; ++q) fq[q] *= gq[q];" << std::endl;
+  count.num_prod += nq;
+  fc << std::endl;
+
+  count = Gkyl::addOps(count, Gkyl::writeQuadProject(fc, "  ", basis, n, "fq", "fg"));
+
+  // close function
+  fc << "}" << std::endl << std::endl;
+
+  Gkyl::writeOpCount(fh, fc, kn.str(), count);
+}
+
+// Generates weak division kernel: computes h such that
+// proj(g*h) = f. The weak-multiplication matrix A_ik = <b_i b_k g> is
+// built symbolically. For small bases (up to 4 basis functions) the
+// solution is written out in closed form using Cramer's rule. For
+// larger bases an unrolled LU decomposition with partial pivoting on a
+// stack-allocated matrix is emitted. Generated function signature:
+//
+// void foo(const double *f, const double *g, double *fdg)
+//
+// fdg can alias f or g.
+//
+// fh: header file
+// fc: C file
+//
+static void
+gen_ser_div_op(std::ostream& fh, std::ostream& fc, const Gkyl::ModalBasis& basis)
+{
+  int ndim = basis.get_ndim(), polyOrder = basis.get_polyOrder();
+  int nbasis = basis.get_numbasis();
+  lst bc = basis.get_basis();
+
+  std::ostringstream kn;
+  kn << "binop_div_" << ndim << "d_ser_" << "p" << polyOrder;
+
+  // function declaration
+  fh << std::endl
+     << "GKYL_CU_DH void " << kn.str()
+     << "(const double *f, const double *g, double *fdg );" << std::endl;
+
+  // function definition
+  fc << "GKYL_CU_DH" << std::endl;
+  fc << "void" << std::endl;
+  fc << kn.str()
+       << "(const double *f, const double *g, double *fdg )" << std::endl;
+  fc << "{" << std::endl;
+
+  // weak-multiplication matrix A_ik = <b_i b_k g>, which is symmetric
+  symbol f("f"), g("g");
+  auto gexp = basis.expand(g);
+  matrix A(nbasis, nbasis);
+  for (int i=0; i<nbasis; ++i) {
+    std::cout << i << " " << std::flush;
+    for (int k=0; k<=i; ++k) {
+      A(i,k) = basis.innerProd(bc[i]*bc[k], gexp).expand();
+      A(k,i) = A(i,k);
+    }
+  }
+  std::cout << std::endl;
+
+  if (nbasis <= 4) {
+    // closed-form solution using Cramer's rule
+    auto det = A.determinant().expand();
+    fc << "  const double rdet = 1.0/(" << csrc << det.evalf() << ");" << std::endl;
+    fc << "  double tmp[" << nbasis << "] = {0.};" << std::endl;
+    for (int i=0; i<nbasis; ++i) {
+      matrix Ai = A;
+      for (int r=0; r<nbasis; ++r)
+        Ai(r,i) = indexed(f, idx(r,1));
+      fc << "  tmp[" << i << "] = rdet*(" << csrc << Ai.determinant().expand().evalf() << ");" << std::endl;
+    }
+    fc << " " << std::endl;
+    for (int i=0; i<nbasis; ++i)
+      fc << "  fdg[" << i << "] = tmp[" << i << "];" << std::endl;
+  }
+  else {
+    fc << "  double A[" << nbasis << "][" << nbasis << "], x[" << nbasis << "];" << std::endl;
+    for (int i=0; i<nbasis; ++i)
+      for (int k=0; k<nbasis; ++k)
+        fc << "  A[" << i << "][" << k << "] = " << csrc << A(i,k).evalf() << ";" << std::endl;
+    for (int i=0; i<nbasis; ++i)
+      fc << "  x[" << i << "] = f[" << i << "];" << std::endl;
+    fc << " " << std::endl;
+
+    // LU decomposition with partial pivoting, eliminating column k
+    for (int k=0; k<nbasis-1; ++k) {
+      fc << "  {" << std::endl;
+      fc << "    int piv = " << k << "; double amax = fabs(A[" << k << "][" << k << "]);" << std::endl;
+      for (int r=k+1; r<nbasis; ++r)
+        fc << "    if (fabs(A[" << r << "][" << k << "]) > amax) { piv = " << r
+           << "; amax = fabs(A[" << r << "][" << k << "]); }" << std::endl;
+      fc << "    if (piv != " << k << ") {" << std::endl;
+      fc << "      for (int j=" << k << "; j<" << nbasis << "; ++j) { double t = A[" << k << "][j]; A["
+         << k << "][j] = A[piv][j]; A[piv][j] = t; }" << std::endl;
+      fc << "      double t = x[" << k << "]; x[" << k << "] = x[piv]; x[piv] = t;" << std::endl;
+      fc << "    }" << std::endl;
+      fc << "    const double rpiv = 1.0/A[" << k << "][" << k << "];" << std::endl;
+      for (int r=k+1; r<nbasis; ++r) {
+        fc << "    { const double m = A[" << r << "][" << k << "]*rpiv;";
+        for (int j=k+1; j<nbasis; ++j)
+          fc << " A[" << r << "][" << j << "] -= m*A[" << k << "][" << j << "];";
+        fc << " x[" << r << "] -= m*x[" << k << "]; }" << std::endl;
+      }
+      fc << "  }" << std::endl;
+    }
+    fc << " " << std::endl;
+
+    // back-substitution
+    for (int i=nbasis-1; i>=0; --i) {
+      fc << "  fdg[" << i << "] = (x[" << i << "]";
+      for (int j=i+1; j<nbasis; ++j)
+        fc << "-A[" << i << "][" << j << "]*fdg[" << j << "]";
+      fc << ")/A[" << i << "][" << i << "];" << std::endl;
+    }
   }
-  std::cout << std::endl;  
 
   // close function
   fc << "}" << std::endl << std::endl;
+}
+
+// Generates dot-product kernel for ncomp-component fields: computes
+// sum_c proj(f_c*g_c). Component c of f and g is stored in
+// f[c*nbasis ... (c+1)*nbasis-1]. The projected product is computed
+// once and reused for each component. Generated function signature:
+//
+// void foo(const double *f, const double *g, double *fdotg)
+//
+// fh: header file
+// fc: C file
+// fg: projected product in the basis, as returned by calc_mul_proj
+//
+static void
+gen_ser_dot_op(std::ostream& fh, std::ostream& fc, const Gkyl::ModalBasis& basis,
+  int ncomp, const lst& fg)
+{
+  int ndim = basis.get_ndim(), polyOrder = basis.get_polyOrder();
+  int nbasis = basis.get_numbasis();
+
+  std::ostringstream kn;
+  kn << "binop_dot_" << ncomp << "c_" << ndim << "d_ser_" << "p" << polyOrder;
+
+  // function declaration
+  fh << std::endl
+     << "GKYL_CU_DH void " << kn.str()
+     << "(const double *GKYL_RESTRICT f, const double *GKYL_RESTRICT g, double *GKYL_RESTRICT fdotg );" << std::endl;
+
+  // function definition
+  fc << "GKYL_CU_DH" << std::endl;
+  fc << "void" << std::endl;
+  fc << kn.str()
+       << "(const double *GKYL_RESTRICT f, const double *GKYL_RESTRICT g, double *GKYL_RESTRICT fdotg )" << std::endl;
+  fc << "{" << std::endl;
+
+  // map coefficients of each component into the strided arrays
+  symbol f("f"), g("g");
+  std::vector<exmap> cmap(ncomp);
+  for (int c=0; c<ncomp; ++c)
+    for (int k=0; k<nbasis; ++k) {
+      cmap[c][indexed(f, idx(k,1))] = indexed(f, idx(c*nbasis+k,1));
+      cmap[c][indexed(g, idx(k,1))] = indexed(g, idx(c*nbasis+k,1));
+    }
+
+  for (int i=0; i<nbasis; ++i) {
+    ex out = 0;
+    for (int c=0; c<ncomp; ++c)
+      out += fg[i].subs(cmap[c]);
+    fc << "  fdotg[" << i << "] = " << csrc << out << ";" << std::endl;
+  }
 
+  // close function
+  fc << "}" << std::endl << std::endl;
 }
 
 void
@@ -262,6 +533,173 @@ gen_all_ser_mul_op()
   std::cout << "Took " << tm << " seconds" << std::endl;  
 }
 
+void
+gen_all_mul_quad_op()
+{
+  // compute time-stamp
+  char buff[70];
+  time_t t = time(NULL);
+  struct tm curr_tm = *localtime(&t);
+  strftime(buff, sizeof buff, "%c", &curr_tm);
+
+  symbol z0("z0"), z1("z1"), z2("z2"), z3("z3"), z4("z4"), z5("z5");
+  std::vector<symbol> vars { z0, z1, z2, z3, z4, z5 };
+
+  // nodes and weights are computed well beyond double precision (the
+  // other generators in this file run at the default precision)
+  long digits = Digits;
+  Digits = 32;
+
+  std::ofstream mul_file_h("kernels/bin_op/gkyl_binop_mul_quad.h", std::ofstream::out);
+  mul_file_h << "// " << buff << std::endl;
+  mul_file_h << "#pragma once" << std::endl;
+  mul_file_h << "#include <gkyl_util.h>" << std::endl;
+  mul_file_h << "EXTERN_C_BEG" << std::endl;
+
+  struct timespec tstart = gkyl_wall_clock();
+
+  // serendipity: all dimensions for p1 and p2, p3 where the modal
+  // kernels exist (for comparison of op counts); tensor p2
+  for (int dim=1; dim<=6; ++dim) {
+    for (int p=1; p<=(dim<=3 ? 3 : 2); ++p) {
+      std::cout << dim << "dp" << p << " " << std::flush;
+      Gkyl::ModalBasis mbasis(Gkyl::MODAL_SER, dim, 0, vars, p);
+
+      // each function is written to its own file to allow building
+      // kernels in parallel
+      std::ostringstream fn;
+      fn << "kernels/bin_op/binop_mul_quad_" << dim << "d_ser_" << "p" << p << ".c";
+      std::ofstream mul_file_c(fn.str().c_str(), std::ofstream::out);
+      mul_file_c << "// " << buff << std::endl;
+      mul_file_c << "#include <gkyl_binop_mul_quad.h>" << std::endl;
+
+      gen_mul_quad_op(mul_file_h, mul_file_c, "ser", mbasis);
+    }
+  }
+  for (int dim=2; dim<=5; ++dim) {
+    int p = 2;
+    std::cout << dim << "dp" << p << " (tensor) " << std::flush;
+    Gkyl::ModalBasis mbasis(Gkyl::MODAL_TEN, dim, 0, vars, p);
+
+    std::ostringstream fn;
+    fn << "kernels/bin_op/binop_mul_quad_" << dim << "d_tensor_" << "p" << p << ".c";
+    std::ofstream mul_file_c(fn.str().c_str(), std::ofstream::out);
+    mul_file_c << "// " << buff << std::endl;
+    mul_file_c << "#include <gkyl_binop_mul_quad.h>" << std::endl;
+
+    gen_mul_quad_op(mul_file_h, mul_file_c, "tensor", mbasis);
+  }
+  std::cout << std::endl;
+
+  mul_file_h << "EXTERN_C_END" << std::endl;
+  Digits = digits;
+
+  double tm = gkyl_time_diff_now_sec(tstart);
+  std::cout << "Took " << tm << " seconds" << std::endl;
+}
+
+void
+gen_all_ser_div_op()
+{
+  // compute time-stamp
+  char buff[70];
+  time_t t = time(NULL);
+  struct tm curr_tm = *localtime(&t);
+  strftime(buff, sizeof buff, "%c", &curr_tm);
+  
+  int dims[] = { 1, 2, 3 };
+  int max_order[] = { 3, 3, 3 };
+
+  symbol z0("z0"), z1("z1"), z2("z2"), z3("z3"), z4("z4"), z5("z5");
+  std::vector<symbol> vars { z0, z1, z2, z3, z4, z5 };
+
+  std::ofstream div_file_h("kernels/bin_op/gkyl_binop_div_ser.h", std::ofstream::out);
+  div_file_h << "// " << buff << std::endl;
+  div_file_h << "#pragma once" << std::endl;
+  div_file_h << "#include <gkyl_util.h>" << std::endl;
+  div_file_h << "EXTERN_C_BEG" << std::endl;
+  
+  struct timespec tstart = gkyl_wall_clock();
+
+  for (int d=0; d<3; ++d) {
+    int dim = dims[d];
+    for (int p=0; p<=max_order[d]; ++p) {
+      std::cout << dim << "dp" << p << " " << std::flush;
+      Gkyl::ModalBasis mbasis(Gkyl::MODAL_SER, dim, 0, vars, p);
+
+      // each function is written to its own file to allow building
+      // kernels in parallel
+      std::ostringstream fn;
+      fn << "kernels/bin_op/binop_div_" << dim << "d_ser_" << "p" << p << ".c";
+      std::ofstream div_file_c(fn.str().c_str(), std::ofstream::out);
+      div_file_c << "// " << buff << std::endl;
+      div_file_c << "#include <math.h>" << std::endl;
+      div_file_c << "#include <gkyl_binop_div_ser.h>" << std::endl;
+      
+      // generate divide method
+      gen_ser_div_op(div_file_h, div_file_c, mbasis);
+    }
+    std::cout << std::endl;
+  }
+
+  div_file_h << "EXTERN_C_END" << std::endl;
+
+  double tm = gkyl_time_diff_now_sec(tstart);
+  std::cout << "Took " << tm << " seconds" << std::endl;  
+}
+
+void
+gen_all_ser_dot_op()
+{
+  // compute time-stamp
+  char buff[70];
+  time_t t = time(NULL);
+  struct tm curr_tm = *localtime(&t);
+  strftime(buff, sizeof buff, "%c", &curr_tm);
+  
+  int dims[] = { 1, 2, 3 };
+  int max_order[] = { 3, 3, 3 };
+
+  symbol z0("z0"), z1("z1"), z2("z2"), z3("z3"), z4("z4"), z5("z5");
+  std::vector<symbol> vars { z0, z1, z2, z3, z4, z5 };
+
+  std::ofstream dot_file_h("kernels/bin_op/gkyl_binop_dot_ser.h", std::ofstream::out);
+  dot_file_h << "// " << buff << std::endl;
+  dot_file_h << "#pragma once" << std::endl;
+  dot_file_h << "#include <gkyl_util.h>" << std::endl;
+  dot_file_h << "EXTERN_C_BEG" << std::endl;
+  
+  struct timespec tstart = gkyl_wall_clock();
+
+  for (int d=0; d<3; ++d) {
+    int dim = dims[d];
+    for (int p=0; p<=max_order[d]; ++p) {
+      std::cout << dim << "dp" << p << " " << std::flush;
+      Gkyl::ModalBasis mbasis(Gkyl::MODAL_SER, dim, 0, vars, p);
+      lst fg = calc_mul_proj(mbasis, mbasis);
+
+      // each function is written to its own file to allow building
+      // kernels in parallel
+      for (int ncomp=2; ncomp<=3; ++ncomp) {
+        std::ostringstream fn;
+        fn << "kernels/bin_op/binop_dot_" << ncomp << "c_" << dim << "d_ser_" << "p" << p << ".c";
+        std::ofstream dot_file_c(fn.str().c_str(), std::ofstream::out);
+        dot_file_c << "// " << buff << std::endl;
+        dot_file_c << "#include <gkyl_binop_dot_ser.h>" << std::endl;
+      
+        // generate dot-product method
+        gen_ser_dot_op(dot_file_h, dot_file_c, mbasis, ncomp, fg);
+      }
+    }
+    std::cout << std::endl;
+  }
+
+  dot_file_h << "EXTERN_C_END" << std::endl;
+
+  double tm = gkyl_time_diff_now_sec(tstart);
+  std::cout << "Took " << tm << " seconds" << std::endl;  
+}
+
 void
 gen_all_ser_cross_mul_op()
 {
@@ -459,6 +897,9 @@ int
 main(int argc, char **argv)
 {
   gen_all_ser_mul_op();
+  gen_all_mul_quad_op();
+  gen_all_ser_div_op();
+  gen_all_ser_dot_op();
   gen_all_ser_cross_mul_op();
   gen_all_hyb_cross_mul_op();
   gen_all_gkhyb_cross_mul_op();
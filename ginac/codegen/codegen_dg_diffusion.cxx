@@ -0,0 +1,363 @@
+#include <modal_basis.h>
+#include <kernel_util.h>
+#include <iostream>
+#include <memory>
+#include <fstream>
+#include <sstream>
+#include <gkyl_util.h>
+
+using namespace GiNaC;
+
+static const char *dir_names[] = { "x", "y", "z" };
+
+static std::string
+basis_name(Gkyl::ModalBasisType type)
+{
+  return type == Gkyl::MODAL_TEN ? "tensor" : "ser";
+}
+
+// Name of diffusion kernel 'op' of order 'order'
+static std::string
+kernel_name(const std::string& bn, int order, const std::string& op, int ndim, int polyOrder,
+  bool is_var)
+{
+  std::ostringstream kn;
+  kn << "dg_diffusion_order" << order << "_" << op << "_" << ndim << "d_" << bn
+     << "_p" << polyOrder << (is_var ? "_varcoeff" : "_constcoeff");
+  return kn.str();
+}
+
+// Diffusion coefficient in direction dir: either coeff[dir] or an
+// expansion in the cell basis stored at coeff[dir*np], where coeff is
+// the array 'name'
+static ex
+calc_coeff(const Gkyl::ModalBasis& basis, int dir, bool is_var, const char *name = "coeff")
+{
+  symbol coeff(name);
+  if (!is_var)
+    return indexed(coeff, idx(dir,1));
+  int np = basis.get_numbasis();
+  lst bc = basis.get_basis();
+  ex D = 0;
+  for (int k=0; k<np; ++k)
+    D += bc[k]*indexed(coeff, idx(dir*np+k,1));
+  return D;
+}
+
+// Generates DG diffusion volume kernel of order 2k for
+//
+// df/dt = (-1)^(k+1) d^k/dx^k (D d^k f/dx^k)
+//
+// summed over directions. For constant D the equation is integrated by
+// parts 2k times so the volume term is D < d^2k b_l/dz^2k, f >. For
+// variable D it is integrated by parts k times, giving
+// (-1)^k < d^k b_l/dz^k, D d^k f/dz^k >. Generated function signature:
+//
+// double foo(const double *w, const double *dx, const double *coeff, const double *q, double *out)
+//
+// coeff: D in each direction, or its expansion in each direction for varcoeff kernels
+//
+// Returns estimate of the CFL frequency at the cell-center.
+//
+// fh: header file
+// fc: C file
+//
+static void
+gen_diffusion_vol(Gkyl::ModalBasisType type, std::ostream& fh, std::ostream& fc,
+  const Gkyl::ModalBasis& basis, int k, bool is_var)
+{
+  int ndim = basis.get_ndim(), polyOrder = basis.get_polyOrder(), np = basis.get_numbasis();
+  lst bc = basis.get_basis();
+  std::string kn = kernel_name(basis_name(type), 2*k, "vol", ndim, polyOrder, is_var);
+  std::string args =
+    "(const double *w, const double *dx, const double *coeff, const double *q, double *GKYL_RESTRICT out )";
+
+  // function declaration
+  fh << std::endl << "GKYL_CU_DH double " << kn << args << ";" << std::endl;
+
+  // function definition
+  fc << "GKYL_CU_DH" << std::endl;
+  fc << "double" << std::endl;
+  fc << kn << args << std::endl;
+  fc << "{" << std::endl;
+
+  struct gkyl_kern_op_count count = { 0 };
+  symbol dx("dx"), q("q");
+  int sign = k%2 == 1 ? 1 : -1;
+
+  exmap center;
+  for (int d=0; d<ndim; ++d) center[basis.get_var(d)] = 0;
+
+  fc << "  double cflFreq_mid = 0.0;" << std::endl;
+  lst qsym, outs;
+  for (int m=0; m<np; ++m)
+    qsym.append( indexed(q, idx(m,1)) );
+  std::vector<ex> out(np, 0);
+  for (int d=0; d<ndim; ++d) {
+    const symbol& z = basis.get_var(d);
+    ex rdx2k = pow(2/indexed(dx, idx(d,1)), 2*k);
+    ex D = calc_coeff(basis, d, is_var);
+
+    // (p+1)^2k
+    int pk = 1;
+    for (int n=0; n<2*k; ++n) pk *= polyOrder+1;
+    auto cfl = (pk*rdx2k*D.subs(center)).expand().evalf();
+    fc << "  cflFreq_mid += fabs(" << csrc << cfl << ");" << std::endl;
+    count = Gkyl::addOps(count, Gkyl::countOps(cfl));
+    count.num_sum += 1;
+
+    for (int l=0; l<np; ++l) {
+      if (!is_var) {
+        ex dkb = GiNaC::diff(bc[l], z, 2*k);
+        if (dkb.is_zero()) continue;
+        lst proj_l = basis.project(dkb);
+        for (int m=0; m<np; ++m)
+          out[l] += sign*rdx2k*D*proj_l[m]*qsym[m];
+      }
+      else {
+        ex dkb = GiNaC::diff(bc[l], z, k);
+        if (dkb.is_zero()) continue;
+        ex dkq = GiNaC::diff(basis.expand(q), z, k);
+        out[l] += sign*(k%2 == 1 ? -1 : 1)*rdx2k*basis.innerProd(dkb, D*dkq);
+      }
+    }
+  }
+  for (int l=0; l<np; ++l)
+    outs.append(out[l].expand());
+  count = Gkyl::addOps(count, Gkyl::writeIncrCSE(fc, outs, qsym));
+  fc << std::endl;
+
+  fc << "  return cflFreq_mid;" << std::endl;
+  // close function
+  fc << "}" << std::endl << std::endl;
+
+  Gkyl::writeOpCount(fh, fc, kn, count);
+}
+
+// Writes projections of the derivatives d^n h/dz^n, n = 0, ..., nmax-1,
+// on the face z = zf into arrays name0, name1, ... Derivatives that
+// vanish identically are not written. Returns the expansions of the
+// written derivatives in terms of the arrays.
+static std::vector<ex>
+write_face_coeff(std::ostream& fc, const std::string& name, const Gkyl::ModalBasis *sbasis,
+  const ex& h, const symbol& z, int zf, int nmax, struct gkyl_kern_op_count& count)
+{
+  exmap mz; mz[z] = zf;
+  std::vector<ex> hexp(nmax, 0);
+  for (int n=0; n<nmax; ++n) {
+    lst hn = Gkyl::faceProject(sbasis, GiNaC::diff(h, z, n).subs(mz).expand());
+    bool is_zero = true;
+    for (size_t s=0; s<hn.nops(); ++s)
+      if (!hn[s].is_zero()) is_zero = false;
+    if (is_zero) continue;
+
+    std::ostringstream nn;
+    nn << name << n;
+    symbol ns(nn.str());
+    fc << "  double " << nn.str() << "[" << hn.nops() << "];" << std::endl;
+    count = Gkyl::addOps(count, Gkyl::writeAssign(fc, "  ", nn.str(), hn));
+    for (int s=0; s<(int) hn.nops(); ++s)
+      hexp[n] += (sbasis == NULL ? ex(1) : sbasis->get_basis()[s])*indexed(ns, idx(s,1));
+  }
+  return hexp;
+}
+
+// Generates DG diffusion surface kernel of order 2k in direction
+// dir. The face values in the repeated integrations by parts are
+// replaced by the recovery polynomial across each face. Derivatives of
+// the recovered solution on the two faces of the cell are projected
+// once into face coefficient arrays, which all the boundary terms
+// then share. For variable coefficients D is also recovered across
+// each face from the two cells sharing it, so that both cells compute
+// the same flux and the scheme is conservative. Generated function
+// signatures:
+//
+// double foo(const double *w, const double *dx, const double *coeff,
+//   const double *ql, const double *qc, const double *qr, double *out)
+// double foo_varcoeff(const double *w, const double *dx, const double *coeffl,
+//   const double *coeffc, const double *coeffr, const double *ql, const double *qc,
+//   const double *qr, double *out)
+//
+// Returns 0.0 (the CFL frequency is computed by the volume kernel).
+//
+// fh: header file
+// fc: C file
+//
+static void
+gen_diffusion_surf(Gkyl::ModalBasisType type, std::ostream& fh, std::ostream& fc,
+  const Gkyl::ModalBasis& basis, int k, bool is_var, int dir)
+{
+  int ndim = basis.get_ndim(), polyOrder = basis.get_polyOrder(), np = basis.get_numbasis();
+  lst bc = basis.get_basis();
+  std::string kn = kernel_name(basis_name(type), 2*k,
+    std::string("surf") + dir_names[dir], ndim, polyOrder, is_var);
+  std::string args = is_var ?
+    "(const double *w, const double *dx, const double *coeffl, const double *coeffc, const double *coeffr, const double *ql, const double *qc, const double *qr, double *GKYL_RESTRICT out )" :
+    "(const double *w, const double *dx, const double *coeff, const double *ql, const double *qc, const double *qr, double *GKYL_RESTRICT out )";
+
+  // function declaration
+  fh << std::endl << "GKYL_CU_DH double " << kn << args << ";" << std::endl;
+
+  // function definition
+  fc << "GKYL_CU_DH" << std::endl;
+  fc << "double" << std::endl;
+  fc << kn << args << std::endl;
+  fc << "{" << std::endl;
+
+  struct gkyl_kern_op_count count = { 0 };
+  symbol dx("dx"), qls("ql"), qcs("qc"), qrs("qr");
+  const symbol& z = basis.get_var(dir);
+  int sign = k%2 == 1 ? 1 : -1;
+
+  // surface basis, or none in 1D where the face is a point
+  std::unique_ptr<Gkyl::ModalBasis> sbasis;
+  if (ndim > 1)
+    sbasis.reset(new Gkyl::ModalBasis(basis.surfBasis(dir)));
+
+  // recovery polynomials on the left and right faces, in a coordinate
+  // centered on the face
+  ex gl = Gkyl::recoverFace(basis, dir, basis.expand(qls), basis.expand(qcs));
+  ex gr = Gkyl::recoverFace(basis, dir, basis.expand(qcs), basis.expand(qrs));
+
+  // quantity h whose derivatives d^(nterm-1-m)h/dz^(m) appear in the
+  // boundary terms: h = g for constant D, h = D d^k g/dz^k otherwise,
+  // with D recovered across the face like g
+  int nterm = is_var ? k : 2*k;
+  ex hl = gl, hr = gr;
+  ex fac = sign*pow(2/indexed(dx, idx(dir,1)), 2*k);
+  if (is_var) {
+    ex Dl = calc_coeff(basis, dir, is_var, "coeffl");
+    ex Dc = calc_coeff(basis, dir, is_var, "coeffc");
+    ex Dr = calc_coeff(basis, dir, is_var, "coeffr");
+    hl = (Gkyl::recoverFace(basis, dir, Dl, Dc)*GiNaC::diff(gl, z, k)).expand();
+    hr = (Gkyl::recoverFace(basis, dir, Dc, Dr)*GiNaC::diff(gr, z, k)).expand();
+  }
+  else {
+    fac = fac*calc_coeff(basis, dir, is_var);
+  }
+  auto face = fac.evalf();
+  fc << "  const double fac = " << csrc << face << ";" << std::endl;
+  count = Gkyl::addOps(count, Gkyl::countOps(face));
+  fc << std::endl;
+
+  std::vector<ex> hl_exp = write_face_coeff(fc, "hl", sbasis.get(), hl, z, 0, nterm, count);
+  std::vector<ex> hr_exp = write_face_coeff(fc, "hr", sbasis.get(), hr, z, 0, nterm, count);
+  fc << std::endl;
+
+  // out_i += fac*sum_m (-1)^m [d^m b_i/dz^m d^(nterm-1-m) h/dz^(nterm-1-m)] from z=-1 to z=+1
+  symbol fac_s("fac");
+  exmap ml; ml[z] = -1;
+  exmap mr; mr[z] = 1;
+  for (int i=0; i<np; ++i) {
+    ex out = 0;
+    for (int m=0; m<nterm; ++m) {
+      ex dmb = GiNaC::diff(bc[i], z, m);
+      if (dmb.is_zero()) continue;
+      int n = nterm-1-m;
+      ex t = 0;
+      if (sbasis) {
+        t = sbasis->innerProd(dmb.subs(mr), hr_exp[n]) - sbasis->innerProd(dmb.subs(ml), hl_exp[n]);
+      }
+      else {
+        t = dmb.subs(mr)*hr_exp[n] - dmb.subs(ml)*hl_exp[n];
+      }
+      out += (m%2 == 0 ? 1 : -1)*t;
+    }
+    out = (fac_s*out.expand()).evalf();
+    if (out.is_zero()) continue;
+    fc << "  out[" << i << "] += " << csrc << out << ";" << std::endl;
+    count = Gkyl::addOps(count, Gkyl::countOps(out));
+    count.num_sum += 1;
+  }
+  fc << std::endl;
+  fc << "  return 0.0;" << std::endl;
+
+  // close function
+  fc << "}" << std::endl << std::endl;
+
+  Gkyl::writeOpCount(fh, fc, kn, count);
+}
+
+// Generates volume and surface kernels of orders 2, 4 and 6 for
+// basis. Order 6 is skipped for p=1: the two-cell recovery polynomial
+// is cubic and all the order 6 terms vanish on a linear basis
+static void
+gen_diffusion_basis(Gkyl::ModalBasisType type, std::ostream& fh, const char *buff,
+  const Gkyl::ModalBasis& basis)
+{
+  std::string bn = basis_name(type);
+  int ndim = basis.get_ndim(), p = basis.get_polyOrder();
+
+  for (int k=1; k<=(p == 1 ? 2 : 3); ++k) {
+    for (int v=0; v<2; ++v) {
+      bool is_var = v == 1;
+
+      // each function is written to its own file to allow building
+      // kernels in parallel
+      std::string vn = kernel_name(bn, 2*k, "vol", ndim, p, is_var);
+      std::ofstream vol_file_c(("kernels/dg_diffusion/" + vn + ".c").c_str(), std::ofstream::out);
+      vol_file_c << "// " << buff << std::endl;
+      vol_file_c << "#include <math.h>" << std::endl;
+      vol_file_c << "#include <gkyl_dg_diffusion_kernels.h>" << std::endl;
+      gen_diffusion_vol(type, fh, vol_file_c, basis, k, is_var);
+
+      for (int dir=0; dir<ndim; ++dir) {
+        std::string sn = kernel_name(bn, 2*k, std::string("surf") + dir_names[dir], ndim, p, is_var);
+        std::ofstream surf_file_c(("kernels/dg_diffusion/" + sn + ".c").c_str(), std::ofstream::out);
+        surf_file_c << "// " << buff << std::endl;
+        surf_file_c << "#include <gkyl_dg_diffusion_kernels.h>" << std::endl;
+        gen_diffusion_surf(type, fh, surf_file_c, basis, k, is_var, dir);
+      }
+    }
+  }
+}
+
+void
+gen_all_diffusion()
+{
+  // compute time-stamp
+  char buff[70];
+  time_t t = time(NULL);
+  struct tm curr_tm = *localtime(&t);
+  strftime(buff, sizeof buff, "%c", &curr_tm);
+
+  symbol z0("z0"), z1("z1"), z2("z2"), z3("z3"), z4("z4"), z5("z5");
+  std::vector<symbol> vars { z0, z1, z2, z3, z4, z5 };
+
+  std::ofstream diff_file_h("kernels/dg_diffusion/gkyl_dg_diffusion_kernels.h", std::ofstream::out);
+  diff_file_h << "// " << buff << std::endl;
+  diff_file_h << "#pragma once" << std::endl;
+  diff_file_h << "#include <gkyl_util.h>" << std::endl;
+  diff_file_h << "EXTERN_C_BEG" << std::endl;
+
+  struct timespec tstart = gkyl_wall_clock();
+
+  for (int dim=1; dim<=3; ++dim) {
+    for (int p=1; p<=3; ++p) {
+      std::cout << dim << "d" << "p" << p << " " << std::flush;
+      Gkyl::ModalBasis basis(Gkyl::MODAL_SER, dim, 0, vars, p);
+      gen_diffusion_basis(Gkyl::MODAL_SER, diff_file_h, buff, basis);
+    }
+  }
+  // tensor basis differs from serendipity only for p > 1
+  for (int dim=2; dim<=3; ++dim) {
+    int p = 2;
+    std::cout << dim << "d" << "p" << p << " (tensor) " << std::flush;
+    Gkyl::ModalBasis basis(Gkyl::MODAL_TEN, dim, 0, vars, p);
+    gen_diffusion_basis(Gkyl::MODAL_TEN, diff_file_h, buff, basis);
+  }
+  std::cout << std::endl;
+
+  diff_file_h << "EXTERN_C_END" << std::endl;
+
+  double tm = gkyl_time_diff_now_sec(tstart);
+  std::cout << "Took " << tm << " seconds" << std::endl;
+}
+
+int
+main(int argc, char **argv)
+{
+  gen_all_diffusion();
+
+  return 1;
+}
@@ -0,0 +1,732 @@
+#include <nodal_basis.h>
+#include <kernel_util.h>
+#include <cassert>
+#include <iostream>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <gkyl_util.h>
+
+using namespace GiNaC;
+
+// Global nodes live on a lattice with p*nc[d]+1 points in direction
+// d. A lattice point i_d is written as i_d = p*m_d + par_d. For p=1 and
+// tensor p=2 every lattice point is a node, while serendipity p=2
+// nodes have at most one odd (par_d = 1) coordinate. Nodes are
+// numbered lexicographically with the first coordinate varying
+// slowest, so that within a row the columns sorted by lattice offset
+// are also sorted by global index.
+
+static std::string
+basis_name(const Gkyl::NodalBasis& basis)
+{
+  return basis.get_type() == Gkyl::MODAL_SER ? "ser" : "tensor";
+}
+
+// Symbols standing for nc[d], and for m_d = idx[d]/p
+static std::vector<symbol> nsym { symbol("n0"), symbol("n1"), symbol("n2") };
+static std::vector<symbol> msym { symbol("m0"), symbol("m1"), symbol("m2") };
+
+static bool
+is_full_lattice(const Gkyl::NodalBasis& basis)
+{
+  return basis.get_polyOrder() == 1 || basis.get_type() == Gkyl::MODAL_TEN;
+}
+
+// Number of nodes in the sub-lattice spanned by directions d0,
+// ..., ndim-1 with at most 'budget' odd coordinates
+static ex
+count_nodes(const Gkyl::NodalBasis& basis, int d0, int budget)
+{
+  int ndim = basis.get_ndim(), p = basis.get_polyOrder();
+  if (d0 == ndim) return 1;
+  if (is_full_lattice(basis))
+    return (p*nsym[d0]+1)*count_nodes(basis, d0+1, budget);
+  ex c = (nsym[d0]+1)*count_nodes(basis, d0+1, budget);
+  if (budget > 0)
+    c += nsym[d0]*count_nodes(basis, d0+1, budget-1);
+  return c;
+}
+
+// Global index of the node at lattice point p*m+par
+static ex
+global_index(const Gkyl::NodalBasis& basis, const std::vector<ex>& m, const std::vector<int>& par)
+{
+  int ndim = basis.get_ndim(), p = basis.get_polyOrder();
+  ex g = 0;
+  if (is_full_lattice(basis)) {
+    for (int d=0; d<ndim; ++d)
+      g += (p*m[d]+par[d])*count_nodes(basis, d+1, ndim);
+  }
+  else {
+    int b = 1;
+    for (int d=0; d<ndim; ++d) {
+      ex pair = count_nodes(basis, d+1, b);
+      if (b > 0) pair += count_nodes(basis, d+1, b-1);
+      g += m[d]*pair + par[d]*count_nodes(basis, d+1, b);
+      b -= par[d];
+    }
+  }
+  return g.expand();
+}
+
+// Integer polynomial in the n_d, m_d (and c_d) as C source
+static std::string
+int_src(const ex& e)
+{
+  std::ostringstream s;
+  s << dflt << e.expand();
+  assert(s.str().find_first_of("^/.") == std::string::npos);
+  return s.str();
+}
+
+// Writes declarations "const long v_d = arr[d]suf;" for the v_d that
+// appear in the function body
+static void
+write_used_locals(std::ostream& fc, const std::string& body, const std::string& v,
+  const std::string& arr, const std::string& suf, int ndim)
+{
+  for (int d=0; d<ndim; ++d) {
+    std::ostringstream vd;
+    vd << v << d;
+    if (body.find(vd.str()) != std::string::npos)
+      fc << "  const long " << vd.str() << " = " << arr << "[" << d << "]" << suf << ";" << std::endl;
+  }
+}
+
+// Element local stiffness matrix K_kl = sum_d <d b_k/dx_d, d b_l/dx_d>
+// on a cell of size dx
+static matrix
+calc_stiff(const Gkyl::NodalBasis& basis)
+{
+  int ndim = basis.get_ndim(), nb = basis.get_numbasis();
+  symbol dx("dx");
+  ex vol = 1;
+  for (int d=0; d<ndim; ++d) vol *= indexed(dx, idx(d,1))/2;
+
+  matrix K(nb, nb);
+  for (int d=0; d<ndim; ++d) {
+    lst db = basis.diffBasis(d);
+    ex rdx2 = 4/pow(indexed(dx, idx(d,1)), 2);
+    for (int k=0; k<nb; ++k)
+      for (int l=0; l<=k; ++l) {
+        ex kl = vol*rdx2*basis.innerProd(db[k], db[l]);
+        K(k,l) = K(k,l) + kl;
+        if (l != k) K(l,k) = K(l,k) + kl;
+      }
+  }
+  return K;
+}
+
+// Generates functions returning the number of global nodes and the
+// global index of the node at a lattice point, and a local-to-global
+// map for the nodes of a cell. Generated function signatures:
+//
+// long foo_num_nodes(const int *nc)
+// long foo_global_idx(const int *nc, const int *idx)
+// void foo_local_to_global(const int *nc, const int *cidx, long *globalIdxs)
+//
+// nc: number of cells in each direction
+// idx: lattice coordinates of the node, 0 <= idx[d] <= p*nc[d]
+// cidx: cell index (0-based)
+//
+// fh: header file
+// fc: C file
+//
+static void
+gen_numbering(std::ostream& fh, std::ostream& fc, const std::string& kn, const Gkyl::NodalBasis& basis)
+{
+  int ndim = basis.get_ndim(), p = basis.get_polyOrder(), nb = basis.get_numbasis();
+  const std::vector<std::vector<int> >& nodes = basis.get_nodes();
+
+  fh << std::endl;
+  fh << "GKYL_CU_DH long " << kn << "_num_nodes(const int *nc);" << std::endl;
+  fh << "GKYL_CU_DH long " << kn << "_global_idx(const int *nc, const int *idx);" << std::endl;
+  fh << "GKYL_CU_DH void " << kn << "_local_to_global(const int *nc, const int *cidx, long *globalIdxs);" << std::endl;
+
+  fc << "GKYL_CU_DH" << std::endl;
+  fc << "long" << std::endl;
+  fc << kn << "_num_nodes(const int *nc)" << std::endl;
+  fc << "{" << std::endl;
+  std::string body = "  return " + int_src(count_nodes(basis, 0, is_full_lattice(basis) ? ndim : 1)) + ";\n";
+  write_used_locals(fc, body, "n", "nc", "", ndim);
+  fc << body;
+  fc << "}" << std::endl << std::endl;
+
+  fc << "GKYL_CU_DH" << std::endl;
+  fc << "long" << std::endl;
+  fc << kn << "_global_idx(const int *nc, const int *idx)" << std::endl;
+  fc << "{" << std::endl;
+  std::vector<ex> m(msym.begin(), msym.begin()+ndim);
+  if (is_full_lattice(basis)) {
+    // here m_d holds idx[d] and not idx[d]/p
+    exmap msub;
+    for (int d=0; d<ndim; ++d)
+      msub[msym[d]] = msym[d]/p;
+    body = "  return " + int_src(global_index(basis, m, std::vector<int>(ndim, 0)).subs(msub)) + ";\n";
+    write_used_locals(fc, body, "n", "nc", "", ndim);
+    write_used_locals(fc, body, "m", "idx", "", ndim);
+    fc << body;
+  }
+  else {
+    // one branch per parity of the lattice coordinates
+    std::ostringstream sw;
+    sw << "  switch (par) {" << std::endl;
+    for (int od=-1; od<ndim; ++od) {
+      std::vector<int> par(ndim, 0);
+      if (od >= 0) par[od] = 1;
+      sw << "    case " << (od >= 0 ? 1<<od : 0) << ": return "
+         << int_src(global_index(basis, m, par)) << ";" << std::endl;
+    }
+    sw << "  }" << std::endl;
+    sw << "  return -1;" << std::endl;
+    write_used_locals(fc, sw.str(), "n", "nc", "", ndim);
+    write_used_locals(fc, sw.str(), "m", "idx", "/2", ndim);
+    fc << "  int par = 0;" << std::endl;
+    for (int d=0; d<ndim; ++d)
+      fc << "  par += (idx[" << d << "]%2) << " << d << ";" << std::endl;
+    fc << sw.str();
+  }
+  fc << "}" << std::endl << std::endl;
+
+  // node k of cell cidx is at lattice point p*cidx + (z_k+1)*p/2
+  symbol c0("c0"), c1("c1"), c2("c2");
+  std::vector<symbol> csym { c0, c1, c2 };
+  std::ostringstream l2g;
+  for (int k=0; k<nb; ++k) {
+    std::vector<ex> mk(ndim);
+    std::vector<int> park(ndim);
+    for (int d=0; d<ndim; ++d) {
+      int l = (nodes[k][d]+1)*p/2;
+      mk[d] = csym[d] + l/p;
+      park[d] = l%p;
+    }
+    l2g << "  globalIdxs[" << k << "] = " << int_src(global_index(basis, mk, park)) << ";" << std::endl;
+  }
+  fc << "GKYL_CU_DH" << std::endl;
+  fc << "void" << std::endl;
+  fc << kn << "_local_to_global(const int *nc, const int *cidx, long *globalIdxs)" << std::endl;
+  fc << "{" << std::endl;
+  write_used_locals(fc, l2g.str(), "n", "nc", "", ndim);
+  write_used_locals(fc, l2g.str(), "c", "cidx", "", ndim);
+  fc << l2g.str();
+  fc << "}" << std::endl << std::endl;
+}
+
+// Generates the element local stiffness matrix and the local source
+// vector, the projection of the modal (DG) expansion of rho on the
+// nodal basis functions. Generated function signatures:
+//
+// void foo_local_stiff(const double *dx, double *K)
+// void foo_local_src(const double *dx, const double *rho, double *bsrc)
+//
+// K is stored row-major.
+//
+// fh: header file
+// fc: C file
+//
+static void
+gen_local(std::ostream& fh, std::ostream& fc, const std::string& kn, const Gkyl::NodalBasis& basis,
+  const matrix& K)
+{
+  int ndim = basis.get_ndim(), nb = basis.get_numbasis();
+
+  fh << "GKYL_CU_DH void " << kn << "_local_stiff(const double *dx, double *GKYL_RESTRICT K);" << std::endl;
+  fh << "GKYL_CU_DH void " << kn << "_local_src(const double *dx, const double *rho, double *GKYL_RESTRICT bsrc);" << std::endl;
+
+  fc << "GKYL_CU_DH" << std::endl;
+  fc << "void" << std::endl;
+  fc << kn << "_local_stiff(const double *dx, double *GKYL_RESTRICT K)" << std::endl;
+  fc << "{" << std::endl;
+  for (int k=0; k<nb; ++k)
+    for (int l=0; l<nb; ++l)
+      fc << "  K[" << k*nb+l << "] = " << csrc << K(k,l).expand().evalf() << ";" << std::endl;
+  fc << "}" << std::endl << std::endl;
+
+  symbol dx("dx"), rho("rho");
+  ex vol = 1;
+  for (int d=0; d<ndim; ++d) vol *= indexed(dx, idx(d,1))/2;
+  const Gkyl::ModalBasis& mbasis = basis.get_modal();
+  ex rhoexp = mbasis.expand(rho);
+  lst bc = basis.get_basis();
+
+  fc << "GKYL_CU_DH" << std::endl;
+  fc << "void" << std::endl;
+  fc << kn << "_local_src(const double *dx, const double *rho, double *GKYL_RESTRICT bsrc)" << std::endl;
+  fc << "{" << std::endl;
+  for (int k=0; k<nb; ++k)
+    fc << "  bsrc[" << k << "] = " << csrc << (vol*basis.innerProd(bc[k], rhoexp)).expand().evalf()
+       << ";" << std::endl;
+  fc << "}" << std::endl << std::endl;
+}
+
+// Generates the assembled row of the global stiffness matrix
+// epsilon*K for the node at lattice point idx, in CSR form: column
+// indices in increasing order and values. Rows fall in classes set by
+// the parity and position (lower boundary, interior, upper boundary)
+// of the node in each direction. For each class the row pattern, the
+// column offsets (as closed-form expressions of the grid size) and the
+// values are fixed, so that the global matrix can be filled row by
+// row without sorting. Boundary conditions are not applied. Generated
+// function signatures:
+//
+// int foo_row_nnz(const int *nc, const int *idx)
+// int foo_row(const int *nc, const int *idx, const double *dx, double epsilon, long *cols, double *vals)
+//
+// Both return the number of entries in the row.
+//
+// fh: header file
+// fc: C file
+//
+static void
+gen_rows(std::ostream& fh, std::ostream& fc, const std::string& kn, const Gkyl::NodalBasis& basis,
+  const matrix& K)
+{
+  int ndim = basis.get_ndim(), p = basis.get_polyOrder(), nb = basis.get_numbasis();
+  const std::vector<std::vector<int> >& nodes = basis.get_nodes();
+
+  fh << "GKYL_CU_DH int " << kn << "_row_nnz(const int *nc, const int *idx);" << std::endl;
+  fh << "GKYL_CU_DH int " << kn << "_row(const int *nc, const int *idx, const double *dx, double epsilon, "
+     << "long *GKYL_RESTRICT cols, double *GKYL_RESTRICT vals);" << std::endl;
+
+  // local lattice coordinates of element nodes
+  std::vector<std::vector<int> > lnode(nb, std::vector<int>(ndim));
+  for (int k=0; k<nb; ++k)
+    for (int d=0; d<ndim; ++d)
+      lnode[k][d] = (nodes[k][d]+1)*p/2;
+
+  // class of direction d: 0 lower, 1 interior, 2 upper boundary, 3 odd
+  int ncls = 1;
+  for (int d=0; d<ndim; ++d) ncls *= 4;
+
+  std::ostringstream cls_code;
+  cls_code << "  int cls = 0;" << std::endl;
+  for (int d=0; d<ndim; ++d) {
+    cls_code << "  cls += (";
+    if (p == 2) cls_code << "idx[" << d << "]%2 ? 3 : ";
+    cls_code << "(idx[" << d << "] == 0 ? 0 : (idx[" << d << "] == " << p << "*nc[" << d << "] ? 2 : 1)))";
+    cls_code << " << " << 2*d << ";" << std::endl;
+  }
+
+  std::ostringstream nnz_c, row_c;
+  for (int cls=0; cls<ncls; ++cls) {
+    std::vector<int> c(ndim), par(ndim);
+    int nodd = 0;
+    bool valid = true;
+    for (int d=0; d<ndim; ++d) {
+      c[d] = (cls >> 2*d) & 3;
+      par[d] = c[d] == 3 ? 1 : 0;
+      nodd += par[d];
+      if (p == 1 && c[d] == 3) valid = false;
+    }
+    if (!valid || (!is_full_lattice(basis) && nodd > 1)) continue;
+
+    // local coordinates the row node can have in the adjacent cells
+    std::vector<std::vector<int> > lpos(ndim);
+    for (int d=0; d<ndim; ++d) {
+      if (c[d] == 3) lpos[d].push_back(1);
+      if (c[d] == 0 || c[d] == 1) lpos[d].push_back(0);
+      if (c[d] == 1 || c[d] == 2) lpos[d].push_back(p);
+    }
+
+    // sum contributions of all adjacent cells, keyed by lattice offset
+    std::map<std::vector<int>, ex> row;
+    int ncell = 1;
+    for (int d=0; d<ndim; ++d) ncell *= lpos[d].size();
+    for (int e=0; e<ncell; ++e) {
+      std::vector<int> l(ndim);
+      int r = e;
+      for (int d=0; d<ndim; ++d) { l[d] = lpos[d][r % lpos[d].size()]; r /= lpos[d].size(); }
+      int kr = -1;
+      for (int k=0; k<nb; ++k)
+        if (lnode[k] == l) kr = k;
+      assert(kr >= 0);
+      for (int j=0; j<nb; ++j) {
+        std::vector<int> a(ndim);
+        for (int d=0; d<ndim; ++d) a[d] = lnode[j][d]-l[d];
+        row[a] += K(kr,j);
+      }
+    }
+
+    std::vector<ex> m(msym.begin(), msym.begin()+ndim);
+    ex grow = global_index(basis, m, par);
+
+    nnz_c << "    case " << cls << ": return " << row.size() << ";" << std::endl;
+    row_c << "    case " << cls << ":" << std::endl;
+    int n = 0;
+    for (auto ritr = row.begin(); ritr != row.end(); ++ritr, ++n) {
+      std::vector<ex> mc(ndim);
+      std::vector<int> parc(ndim);
+      for (int d=0; d<ndim; ++d) {
+        int s = par[d] + ritr->first[d]; // in [-p, p+1]
+        int q = s >= 0 ? s/p : -((-s+p-1)/p);
+        mc[d] = m[d] + q;
+        parc[d] = s - q*p;
+      }
+      row_c << "      cols[" << n << "] = row + (" << int_src(global_index(basis, mc, parc) - grow) << ");" << std::endl;
+      row_c << "      vals[" << n << "] = epsilon*(" << csrc << ritr->second.expand().evalf() << ");" << std::endl;
+    }
+    row_c << "      return " << row.size() << ";" << std::endl;
+  }
+
+  fc << "GKYL_CU_DH" << std::endl;
+  fc << "int" << std::endl;
+  fc << kn << "_row_nnz(const int *nc, const int *idx)" << std::endl;
+  fc << "{" << std::endl;
+  fc << cls_code.str();
+  fc << "  switch (cls) {" << std::endl;
+  fc << nnz_c.str();
+  fc << "  }" << std::endl;
+  fc << "  return 0;" << std::endl;
+  fc << "}" << std::endl << std::endl;
+
+  fc << "GKYL_CU_DH" << std::endl;
+  fc << "int" << std::endl;
+  fc << kn << "_row(const int *nc, const int *idx, const double *dx, double epsilon, "
+     << "long *GKYL_RESTRICT cols, double *GKYL_RESTRICT vals)" << std::endl;
+  fc << "{" << std::endl;
+  std::ostringstream mdiv;
+  mdiv << "/" << p;
+  write_used_locals(fc, row_c.str(), "n", "nc", "", ndim);
+  write_used_locals(fc, row_c.str(), "m", "idx", mdiv.str(), ndim);
+  fc << cls_code.str();
+  fc << "  const long row = " << kn << "_global_idx(nc, idx);" << std::endl;
+  fc << "  switch (cls) {" << std::endl;
+  fc << row_c.str();
+  fc << "  }" << std::endl;
+  fc << "  return 0;" << std::endl;
+  fc << "}" << std::endl << std::endl;
+}
+
+// Expression sum_l A(k_e, l) in[k with k_e replaced by l], where k is
+// the tensor index of a node of a full-lattice element with n1 nodes
+// per direction (first direction varying slowest)
+static ex
+tensor_pass(const matrix& A, const symbol& in, int e, int k, int ndim, int n1)
+{
+  int stride = 1;
+  for (int d=e+1; d<ndim; ++d) stride *= n1;
+  int ke = (k/stride) % n1;
+  ex out = 0;
+  for (int l=0; l<n1; ++l)
+    out += A(ke,l)*indexed(in, idx(k+(l-ke)*stride,1));
+  return out;
+}
+
+// Element matrices of the nodal basis on [-1,1]^ndim: mass M and the
+// stiffness Kd[d] in each direction
+static void
+calc_elem_mats(const Gkyl::NodalBasis& basis, matrix& M, std::vector<matrix>& Kd)
+{
+  int ndim = basis.get_ndim(), nb = basis.get_numbasis();
+  lst bc = basis.get_basis();
+  M = matrix(nb, nb);
+  for (int k=0; k<nb; ++k)
+    for (int l=0; l<nb; ++l)
+      M(k,l) = basis.innerProd(bc[k], bc[l]);
+  for (int d=0; d<ndim; ++d) {
+    lst db = basis.diffBasis(d);
+    matrix K(nb, nb);
+    for (int k=0; k<nb; ++k)
+      for (int l=0; l<nb; ++l)
+        K(k,l) = basis.innerProd(db[k], db[l]);
+    Kd.push_back(K);
+  }
+}
+
+// Generates matrix-free element kernels applying the local operator
+// of the FEM Poisson solver (epsilon times the stiffness matrix) or of
+// the parallel projection (the mass matrix) to an element vector, and
+// computing the local diagonal. For p=1 and tensor p=2 the operator is
+// a sum of Kronecker products of 1D mass (M) and stiffness (S)
+// matrices and is applied by sum factorization, one direction at a
+// time, keeping the all-mass product U and the sum V of terms with one
+// stiffness factor: U' = M_e U, V' = M_e V + c_e S_e U. This costs
+// O(n1^(ndim+1)) instead of O(n1^(2 ndim)). Serendipity p=2 has no
+// tensor structure and the element matrix is applied directly. Also
+// generates batched variants that gather from and scatter-add into
+// global vectors for nelem elements. Generated function signatures:
+//
+// void foo(const double *dx, [double epsilon,] const double *x, double *y)
+// void foo_diag(const double *dx, [double epsilon,] double *diag)
+// void foo_batch(int nelem, const double *dx, [double epsilon,] const long *globalIdxs, const double *x, double *y)
+// void foo_diag_batch(int nelem, const double *dx, [double epsilon,] const long *globalIdxs, double *diag)
+//
+// epsilon is only an argument of the stiffness kernels. All kernels
+// accumulate into y and diag. globalIdxs holds the local-to-global
+// map of each element, nelem*numbasis entries.
+//
+// fh: header file
+// fc: C file
+//
+static void
+gen_apply(std::ostream& fh, std::ostream& fc, const std::string& kn, const Gkyl::NodalBasis& basis,
+  const std::vector<symbol>& vars, bool is_stiff)
+{
+  int ndim = basis.get_ndim(), p = basis.get_polyOrder(), nb = basis.get_numbasis();
+  int n1 = p+1;
+  std::string eps = is_stiff ? " double epsilon," : "";
+  std::string args = "(const double *dx," + eps + " const double *GKYL_RESTRICT x, double *GKYL_RESTRICT y)";
+  std::string diag_args = "(const double *dx," + eps + " double *GKYL_RESTRICT diag)";
+  std::string batch_args = "(int nelem, const double *dx," + eps
+    + " const long *globalIdxs, const double *x, double *GKYL_RESTRICT y)";
+  std::string diag_batch_args = "(int nelem, const double *dx," + eps
+    + " const long *globalIdxs, double *GKYL_RESTRICT diag)";
+
+  fh << std::endl;
+  fh << "GKYL_CU_DH void " << kn << args << ";" << std::endl;
+  fh << "GKYL_CU_DH void " << kn << "_diag" << diag_args << ";" << std::endl;
+  fh << "GKYL_CU_DH void " << kn << "_batch" << batch_args << ";" << std::endl;
+  fh << "GKYL_CU_DH void " << kn << "_diag_batch" << diag_batch_args << ";" << std::endl;
+
+  // scale factors: jacobian, and jacobian*epsilon*(2/dx_d)^2 for the
+  // stiffness in direction d
+  symbol x("x");
+  std::vector<symbol> cs;
+  std::ostringstream scale;
+  scale << "  const double J = 1.0";
+  for (int d=0; d<ndim; ++d) scale << "*0.5*dx[" << d << "]";
+  scale << ";" << std::endl;
+  if (is_stiff)
+    for (int d=0; d<ndim; ++d) {
+      std::ostringstream c;
+      c << "c" << d;
+      cs.push_back(symbol(c.str()));
+      scale << "  const double c" << d << " = 4.0*epsilon*J/(dx[" << d << "]*dx[" << d << "]);" << std::endl;
+    }
+
+  matrix M;
+  std::vector<matrix> Kd;
+  calc_elem_mats(basis, M, Kd);
+
+  struct gkyl_kern_op_count count = { 0 };
+  fc << "GKYL_CU_DH" << std::endl;
+  fc << "void" << std::endl;
+  fc << kn << args << std::endl;
+  fc << "{" << std::endl;
+  fc << scale.str();
+  if (is_full_lattice(basis)) {
+    std::vector<symbol> vars1 { vars[0] };
+    matrix M1, S1;
+    std::vector<matrix> K1;
+    calc_elem_mats(Gkyl::NodalBasis(Gkyl::MODAL_SER, 1, vars1, p), M1, K1);
+    S1 = K1[0];
+
+    // directions are processed from last to first; the last pass
+    // accumulates into y
+    ex uin = x, vin = 0;
+    for (int e=ndim-1; e>=0; --e) {
+      bool last = e == 0;
+      if (!last)
+        fc << "  double u" << e << "[" << nb << "]" << (is_stiff ? ", v" : "");
+      if (!last && is_stiff) fc << e << "[" << nb << "]";
+      if (!last) fc << ";" << std::endl;
+      for (int k=0; k<nb; ++k) {
+        ex uk = tensor_pass(M1, ex_to<symbol>(uin), e, k, ndim, n1);
+        if (last) {
+          ex yk = is_stiff ? cs[e]*tensor_pass(S1, ex_to<symbol>(uin), e, k, ndim, n1) : symbol("J")*uk;
+          if (is_stiff && e != ndim-1)
+            yk += tensor_pass(M1, ex_to<symbol>(vin), e, k, ndim, n1);
+          yk = yk.expand().evalf();
+          fc << "  y[" << k << "] += " << csrc << yk << ";" << std::endl;
+          count = Gkyl::addOps(count, Gkyl::countOps(yk));
+          count.num_sum += 1;
+          continue;
+        }
+        uk = uk.expand().evalf();
+        fc << "  u" << e << "[" << k << "] = " << csrc << uk << ";" << std::endl;
+        count = Gkyl::addOps(count, Gkyl::countOps(uk));
+        if (is_stiff) {
+          ex vk = cs[e]*tensor_pass(S1, ex_to<symbol>(uin), e, k, ndim, n1);
+          if (e != ndim-1)
+            vk += tensor_pass(M1, ex_to<symbol>(vin), e, k, ndim, n1);
+          vk = vk.expand().evalf();
+          fc << "  v" << e << "[" << k << "] = " << csrc << vk << ";" << std::endl;
+          count = Gkyl::addOps(count, Gkyl::countOps(vk));
+        }
+      }
+      std::ostringstream un, vn;
+      un << "u" << e; vn << "v" << e;
+      uin = symbol(un.str()); vin = symbol(vn.str());
+    }
+  }
+  else {
+    // direct application of the element matrix
+    for (int k=0; k<nb; ++k) {
+      ex yk = 0;
+      for (int l=0; l<nb; ++l) {
+        if (is_stiff)
+          for (int d=0; d<ndim; ++d)
+            yk += cs[d]*Kd[d](k,l)*indexed(x, idx(l,1));
+        else
+          yk += symbol("J")*M(k,l)*indexed(x, idx(l,1));
+      }
+      yk = yk.expand().evalf();
+      fc << "  y[" << k << "] += " << csrc << yk << ";" << std::endl;
+      count = Gkyl::addOps(count, Gkyl::countOps(yk));
+      count.num_sum += 1;
+    }
+  }
+  fc << "}" << std::endl << std::endl;
+
+  Gkyl::writeOpCount(fh, fc, kn, count);
+  fc << std::endl;
+
+  // local diagonal
+  fc << "GKYL_CU_DH" << std::endl;
+  fc << "void" << std::endl;
+  fc << kn << "_diag" << diag_args << std::endl;
+  fc << "{" << std::endl;
+  fc << scale.str();
+  for (int k=0; k<nb; ++k) {
+    ex dk = 0;
+    if (is_stiff)
+      for (int d=0; d<ndim; ++d) dk += cs[d]*Kd[d](k,k);
+    else
+      dk = symbol("J")*M(k,k);
+    fc << "  diag[" << k << "] += " << csrc << dk.expand().evalf() << ";" << std::endl;
+  }
+  fc << "}" << std::endl << std::endl;
+
+  // batched variants: gather, apply and scatter-add
+  std::string epsarg = is_stiff ? " epsilon," : "";
+  fc << "GKYL_CU_DH" << std::endl;
+  fc << "void" << std::endl;
+  fc << kn << "_batch" << batch_args << std::endl;
+  fc << "{" << std::endl;
+  fc << "  for (int e=0; e<nelem; ++e) {" << std::endl;
+  fc << "    const long *gi = globalIdxs+e*" << nb << ";" << std::endl;
+  fc << "    double xl[" << nb << "], yl[" << nb << "] = { 0.0 };" << std::endl;
+  fc << "    for (int k=0; k<" << nb << "; ++k) xl[k] = x[gi[k]];" << std::endl;
+  fc << "    " << kn << "(dx," << epsarg << " xl, yl);" << std::endl;
+  fc << "    for (int k=0; k<" << nb << "; ++k) y[gi[k]] += yl[k];" << std::endl;
+  fc << "  }" << std::endl;
+  fc << "}" << std::endl << std::endl;
+
+  fc << "GKYL_CU_DH" << std::endl;
+  fc << "void" << std::endl;
+  fc << kn << "_diag_batch" << diag_batch_args << std::endl;
+  fc << "{" << std::endl;
+  fc << "  double dl[" << nb << "] = { 0.0 };" << std::endl;
+  fc << "  " << kn << "_diag(dx," << epsarg << " dl);" << std::endl;
+  fc << "  for (int e=0; e<nelem; ++e)" << std::endl;
+  fc << "    for (int k=0; k<" << nb << "; ++k) diag[globalIdxs[e*" << nb << "+k]] += dl[k];" << std::endl;
+  fc << "}" << std::endl << std::endl;
+}
+
+void
+gen_all_fem_poisson()
+{
+  // compute time-stamp
+  char buff[70];
+  time_t t = time(NULL);
+  struct tm curr_tm = *localtime(&t);
+  strftime(buff, sizeof buff, "%c", &curr_tm);
+
+  symbol z0("z0"), z1("z1"), z2("z2"), z3("z3"), z4("z4"), z5("z5");
+  std::vector<symbol> vars { z0, z1, z2, z3, z4, z5 };
+
+  std::ofstream fem_file_h("kernels/fem_poisson/gkyl_fem_poisson_kernels.h", std::ofstream::out);
+  fem_file_h << "// " << buff << std::endl;
+  fem_file_h << "#pragma once" << std::endl;
+  fem_file_h << "#include <gkyl_util.h>" << std::endl;
+  fem_file_h << "EXTERN_C_BEG" << std::endl;
+
+  struct timespec tstart = gkyl_wall_clock();
+
+  Gkyl::ModalBasisType types[] = { Gkyl::MODAL_SER, Gkyl::MODAL_TEN };
+  for (int ti=0; ti<2; ++ti) {
+    for (int dim=1; dim<=3; ++dim) {
+      for (int p=1; p<=2; ++p) {
+        // tensor p1 and 1D p2 are the same as serendipity
+        if (types[ti] == Gkyl::MODAL_TEN && (p == 1 || dim == 1)) continue;
+        std::cout << dim << "dp" << p << " " << std::flush;
+        Gkyl::NodalBasis nbasis(types[ti], dim, vars, p);
+        matrix K = calc_stiff(nbasis);
+
+        std::ostringstream kn;
+        kn << "fem_poisson_" << dim << "d_" << basis_name(nbasis) << "_p" << p;
+
+        // each function is written to its own file to allow building
+        // kernels in parallel
+        std::ofstream fem_file_c(("kernels/fem_poisson/" + kn.str() + ".c").c_str(), std::ofstream::out);
+        fem_file_c << "// " << buff << std::endl;
+        fem_file_c << "#include <gkyl_fem_poisson_kernels.h>" << std::endl;
+        gen_numbering(fem_file_h, fem_file_c, kn.str(), nbasis);
+        gen_local(fem_file_h, fem_file_c, kn.str(), nbasis, K);
+        gen_rows(fem_file_h, fem_file_c, kn.str(), nbasis, K);
+
+        std::ostringstream akn;
+        akn << "fem_poisson_apply_stiff_" << dim << "d_" << basis_name(nbasis) << "_p" << p;
+        std::ofstream apply_file_c(("kernels/fem_poisson/" + akn.str() + ".c").c_str(), std::ofstream::out);
+        apply_file_c << "// " << buff << std::endl;
+        apply_file_c << "#include <gkyl_fem_poisson_kernels.h>" << std::endl;
+        gen_apply(fem_file_h, apply_file_c, akn.str(), nbasis, vars, true);
+      }
+    }
+    std::cout << std::endl;
+  }
+
+  fem_file_h << "EXTERN_C_END" << std::endl;
+
+  double tm = gkyl_time_diff_now_sec(tstart);
+  std::cout << "Took " << tm << " seconds" << std::endl;
+}
+
+void
+gen_all_fem_parproj()
+{
+  // compute time-stamp
+  char buff[70];
+  time_t t = time(NULL);
+  struct tm curr_tm = *localtime(&t);
+  strftime(buff, sizeof buff, "%c", &curr_tm);
+
+  symbol z0("z0"), z1("z1"), z2("z2"), z3("z3"), z4("z4"), z5("z5");
+  std::vector<symbol> vars { z0, z1, z2, z3, z4, z5 };
+
+  std::ofstream parproj_file_h("kernels/fem_parproj/gkyl_fem_parproj_kernels.h", std::ofstream::out);
+  parproj_file_h << "// " << buff << std::endl;
+  parproj_file_h << "#pragma once" << std::endl;
+  parproj_file_h << "#include <gkyl_util.h>" << std::endl;
+  parproj_file_h << "EXTERN_C_BEG" << std::endl;
+
+  struct timespec tstart = gkyl_wall_clock();
+
+  Gkyl::ModalBasisType types[] = { Gkyl::MODAL_SER, Gkyl::MODAL_TEN };
+  for (int ti=0; ti<2; ++ti) {
+    for (int dim=1; dim<=3; ++dim) {
+      for (int p=1; p<=2; ++p) {
+        // tensor p1 and 1D p2 are the same as serendipity
+        if (types[ti] == Gkyl::MODAL_TEN && (p == 1 || dim == 1)) continue;
+        std::cout << dim << "dp" << p << " " << std::flush;
+        Gkyl::NodalBasis nbasis(types[ti], dim, vars, p);
+
+        std::ostringstream kn;
+        kn << "fem_parproj_apply_mass_" << dim << "d_" << basis_name(nbasis) << "_p" << p;
+
+        // each function is written to its own file to allow building
+        // kernels in parallel
+        std::ofstream parproj_file_c(("kernels/fem_parproj/" + kn.str() + ".c").c_str(), std::ofstream::out);
+        parproj_file_c << "// " << buff << std::endl;
+        parproj_file_c << "#include <gkyl_fem_parproj_kernels.h>" << std::endl;
+        gen_apply(parproj_file_h, parproj_file_c, kn.str(), nbasis, vars, false);
+      }
+    }
+    std::cout << std::endl;
+  }
+
+  parproj_file_h << "EXTERN_C_END" << std::endl;
+
+  double tm = gkyl_time_diff_now_sec(tstart);
+  std::cout << "Took " << tm << " seconds" << std::endl;
+}
+
+int
+main(int argc, char **argv)
+{
+  gen_all_fem_poisson();
+  gen_all_fem_parproj();
+
+  return 1;
+}
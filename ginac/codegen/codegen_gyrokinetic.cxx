@@ -0,0 +1,377 @@
+#include <modal_basis.h>
+#include <kernel_util.h>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <gkyl_util.h>
+
+using namespace GiNaC;
+
+// Physical component (x,y,z) of each configuration-space direction:
+// the last configuration direction is always parallel to the field
+static const int comp_1x[] = { 2 };
+static const int comp_2x[] = { 0, 2 };
+static const int comp_3x[] = { 0, 1, 2 };
+static const int *conf_comp[] = { NULL, comp_1x, comp_2x, comp_3x };
+static const char *comp_names[] = { "x", "y", "z" };
+
+// Name of direction dir in gyrokinetic phase-space
+static std::string
+dir_name(int cdim, int dir)
+{
+  if (dir < cdim)
+    return comp_names[conf_comp[cdim][dir]];
+  return dir == cdim ? "vpar" : "mu";
+}
+
+// Computes the coefficients of the phase-space characteristic
+// velocities of the electrostatic gyrokinetic system, projected on
+// the phase basis and scaled by 2/dxv[dir] so that they multiply
+// derivatives in logical coordinates. With the Hamiltonian
+//
+// H = m/2*vpar^2 + mu*B + q*phi
+//
+// and the modified field B* = B + m*vpar/q*curl(b), the
+// configuration-space velocity is vpar*B*/B*_par + 1/(q*B*_par)*(b x
+// grad(H)) and the parallel acceleration is -1/(m*B*_par)*B*.grad(H).
+// The curl(b) part of B* gives the curvature drift and the parallel
+// acceleration from the mirror force along it. As in the gkyl kernels
+// 1/B*_par is approximated by 1/B (jacobtot_inv = 1/(J*B)), dropping
+// the m*vpar/q*b.curl(b) correction that is higher order in rho*. The
+// magnetic moment is an invariant and has no flux. Returns one list per
+// direction.
+static std::vector<lst>
+calc_gk_alpha(const Gkyl::ModalBasis& cbasis, const Gkyl::ModalBasis& pbasis)
+{
+  int cdim = cbasis.get_ndim(), pdim = pbasis.get_ndim(), vdim = pdim-cdim;
+  symbol q_("q_"), m_("m_"), w("w"), dxv("dxv");
+  symbol bmag("bmag"), jacobtot_inv("jacobtot_inv"), cmag("cmag"), b_i("b_i"), phi("phi");
+
+  ex vpar = indexed(w, idx(cdim,1)) + indexed(dxv, idx(cdim,1))/2*pbasis.get_var(cdim);
+  ex H = m_*vpar*vpar/2 + q_*Gkyl::confExpand(cbasis, phi, 0);
+  if (vdim > 1) {
+    ex mu = indexed(w, idx(cdim+1,1)) + indexed(dxv, idx(cdim+1,1))/2*pbasis.get_var(cdim+1);
+    H += mu*Gkyl::confExpand(cbasis, bmag, 0);
+  }
+
+  // physical gradients of H and b_i (zero in ignorable directions)
+  ex b[3], gradH[3] = { 0, 0, 0 }, gradb[3][3];
+  for (int j=0; j<3; ++j) {
+    b[j] = Gkyl::confExpand(cbasis, b_i, j);
+    for (int k=0; k<3; ++k) gradb[k][j] = 0;
+  }
+  for (int c=0; c<cdim; ++c) {
+    int k = conf_comp[cdim][c];
+    gradH[k] = 2/indexed(dxv, idx(c,1))*GiNaC::diff(H, pbasis.get_var(c));
+    for (int j=0; j<3; ++j)
+      gradb[k][j] = 2/indexed(dxv, idx(c,1))*GiNaC::diff(b[j], pbasis.get_var(c));
+  }
+
+  ex jinv = Gkyl::confExpand(cbasis, jacobtot_inv, 0), bc = Gkyl::confExpand(cbasis, cmag, 0);
+  ex bxgradH[3], BstarB[3];
+  for (int j=0; j<3; ++j) {
+    bxgradH[j] = b[(j+1)%3]*gradH[(j+2)%3] - b[(j+2)%3]*gradH[(j+1)%3];
+    // B*/B*_par, with curl(b) from the covariant components
+    ex curlb = gradb[(j+1)%3][(j+2)%3] - gradb[(j+2)%3][(j+1)%3];
+    BstarB[j] = m_*vpar/q_*curlb*jinv;
+    if (j == 2) BstarB[j] += bc*jinv;
+  }
+
+  std::vector<lst> alpha(pdim);
+  for (int d=0; d<pdim; ++d) {
+    std::cout << "alpha" << d << " " << std::flush;
+    ex a = 0;
+    if (d < cdim) {
+      int j = conf_comp[cdim][d];
+      a = vpar*BstarB[j] + jinv/q_*bxgradH[j];
+    }
+    else if (d == cdim) {
+      for (int j=0; j<3; ++j)
+        a += -BstarB[j]*gradH[j]/m_;
+    }
+    if (a.is_zero()) {
+      lst zeros;
+      for (int k=0; k<pbasis.get_numbasis(); ++k) zeros.append(0);
+      alpha[d] = zeros;
+    }
+    else {
+      alpha[d] = pbasis.project(2/indexed(dxv, idx(d,1))*a);
+    }
+  }
+  std::cout << std::endl;
+  return alpha;
+}
+
+// Expansion of the characteristic velocity in direction dir stored in
+// array s with layout s[dir*np+k]. Only non-zero coefficients are used.
+static ex
+alpha_expand(const Gkyl::ModalBasis& pbasis, const std::vector<lst>& alpha, const symbol& s, int dir)
+{
+  int np = pbasis.get_numbasis();
+  lst bc = pbasis.get_basis();
+  ex e = 0;
+  for (int k=0; k<np; ++k)
+    if (!alpha[dir][k].is_zero())
+      e += bc[k]*indexed(s, idx(dir*np+k,1));
+  return e;
+}
+
+// Generates kernel computing the characteristic velocities in all
+// phase-space directions of a cell. These are computed once per cell
+// and passed to the volume and surface kernels, so no direction
+// recomputes the geometry and field products. Generated function
+// signature:
+//
+// double foo(double q_, double m_, const double *w, const double *dxv, const double *bmag,
+//   const double *jacobtot_inv, const double *cmag, const double *b_i, const double *phi, double *alpha)
+//
+// bmag, jacobtot_inv, cmag, phi: conf-space expansions
+// b_i: covariant components (x,y,z) of the unit vector along the field, each a conf-space expansion
+// alpha: characteristic velocities, alpha[dir*np+k]. Coefficients that
+//   are identically zero are not written.
+//
+// Returns estimate of the CFL frequency at the cell-center.
+//
+// fh: header file
+// fc: C file
+//
+static void
+gen_gk_alpha(std::ostream& fh, std::ostream& fc,
+  const Gkyl::ModalBasis& cbasis, const Gkyl::ModalBasis& pbasis, const std::vector<lst>& alpha)
+{
+  int cdim = cbasis.get_ndim(), pdim = pbasis.get_ndim(), vdim = pdim-cdim;
+  int polyOrder = pbasis.get_polyOrder(), np = pbasis.get_numbasis();
+
+  std::ostringstream kn;
+  kn << "gyrokinetic_alpha_" << cdim << "x" << vdim << "v_gkhyb_" << "p" << polyOrder;
+  std::string args =
+    "(double q_, double m_, const double *w, const double *dxv, const double *bmag, const double *jacobtot_inv, const double *cmag, const double *b_i, const double *phi, double *GKYL_RESTRICT alpha )";
+
+  // function declaration
+  fh << std::endl << "GKYL_CU_DH double " << kn.str() << args << ";" << std::endl;
+
+  // function definition
+  fc << "GKYL_CU_DH" << std::endl;
+  fc << "double" << std::endl;
+  fc << kn.str() << args << std::endl;
+  fc << "{" << std::endl;
+
+  struct gkyl_kern_op_count count = { 0 };
+  symbol as("alpha");
+  exmap center;
+  for (int d=0; d<pdim; ++d) center[pbasis.get_var(d)] = 0;
+
+  fc << "  double cflFreq_mid = 0.0;" << std::endl;
+  for (int d=0; d<pdim; ++d) {
+    bool has_flux = false;
+    for (int k=0; k<np; ++k) {
+      if (alpha[d][k].is_zero()) continue;
+      auto ak = alpha[d][k].evalf();
+      fc << "  alpha[" << d*np+k << "] = " << csrc << ak << ";" << std::endl;
+      count = Gkyl::addOps(count, Gkyl::countOps(ak));
+      has_flux = true;
+    }
+    if (!has_flux) continue;
+    // the parallel velocity direction is quadratic in the hybrid basis
+    int pdir = d == cdim ? 2 : polyOrder;
+    auto amid = alpha_expand(pbasis, alpha, as, d).subs(center).expand().evalf();
+    fc << "  cflFreq_mid += " << 2*pdir+1 << "*fabs(" << csrc << amid << ");" << std::endl;
+    count = Gkyl::addOps(count, Gkyl::countOps(amid));
+    count.num_sum += 1; count.num_prod += 1;
+  }
+  fc << std::endl;
+  fc << "  return cflFreq_mid;" << std::endl;
+  // close function
+  fc << "}" << std::endl << std::endl;
+
+  Gkyl::writeOpCount(fh, fc, kn.str(), count);
+}
+
+// Generates gyrokinetic volume kernel from characteristic velocities
+// computed by the alpha kernel. Generated function signature:
+//
+// void foo(const double *alpha, const double *f, double *out)
+//
+// fh: header file
+// fc: C file
+//
+static void
+gen_gk_vol(std::ostream& fh, std::ostream& fc,
+  const Gkyl::ModalBasis& cbasis, const Gkyl::ModalBasis& pbasis, const std::vector<lst>& alpha)
+{
+  int cdim = cbasis.get_ndim(), pdim = pbasis.get_ndim(), vdim = pdim-cdim;
+  int polyOrder = pbasis.get_polyOrder();
+
+  std::ostringstream kn;
+  kn << "gyrokinetic_vol_" << cdim << "x" << vdim << "v_gkhyb_" << "p" << polyOrder;
+  std::string args = "(const double *alpha, const double *f, double *GKYL_RESTRICT out )";
+
+  // function declaration
+  fh << std::endl << "GKYL_CU_DH void " << kn.str() << args << ";" << std::endl;
+
+  // function definition
+  fc << "GKYL_CU_DH" << std::endl;
+  fc << "void" << std::endl;
+  fc << kn.str() << args << std::endl;
+  fc << "{" << std::endl;
+
+  symbol as("alpha"), f("f");
+  std::vector<ex> alpha_dir(pdim);
+  for (int d=0; d<pdim; ++d)
+    alpha_dir[d] = alpha_expand(pbasis, alpha, as, d);
+
+  struct gkyl_kern_op_count count = Gkyl::writeVolTerm(fc, pbasis, alpha_dir, f);
+
+  // close function
+  fc << "}" << std::endl << std::endl;
+
+  Gkyl::writeOpCount(fh, fc, kn.str(), count);
+}
+
+// Generates gyrokinetic surface kernel in direction dir. The
+// characteristic velocity on each face is the average of the traces
+// of the precomputed alpha of the two cells sharing the face, so both
+// cells see the same flux and the scheme is conservative. The flux is
+// Lax-Friedrichs with amax = bound of |alpha| on the face, and is
+// lifted into the volume in the same kernel. Generated function
+// signature:
+//
+// void foo(const double *alphal, const double *alphac, const double *alphar,
+//   const double *fl, const double *fc, const double *fr, double *out)
+//
+// fh: header file
+// fc: C file
+//
+static void
+gen_gk_surf(std::ostream& fh, std::ostream& fc,
+  const Gkyl::ModalBasis& cbasis, const Gkyl::ModalBasis& pbasis, const std::vector<lst>& alpha, int dir)
+{
+  int cdim = cbasis.get_ndim(), pdim = pbasis.get_ndim(), vdim = pdim-cdim;
+  int polyOrder = pbasis.get_polyOrder();
+
+  std::ostringstream kn;
+  kn << "gyrokinetic_surf" << dir_name(cdim, dir)
+     << "_" << cdim << "x" << vdim << "v_gkhyb_" << "p" << polyOrder;
+  std::string args =
+    "(const double *alphal, const double *alphac, const double *alphar, const double *fl, const double *fc, const double *fr, double *GKYL_RESTRICT out )";
+
+  // function declaration
+  fh << std::endl << "GKYL_CU_DH void " << kn.str() << args << ";" << std::endl;
+
+  // function definition
+  fc << "GKYL_CU_DH" << std::endl;
+  fc << "void" << std::endl;
+  fc << kn.str() << args << std::endl;
+  fc << "{" << std::endl;
+
+  struct gkyl_kern_op_count count = { 0 };
+  symbol als("alphal"), acs("alphac"), ars("alphar"), fls("fl"), fcs("fc"), frs("fr");
+  Gkyl::ModalBasis sbasis = pbasis.surfBasis(dir);
+  int ns = sbasis.get_numbasis();
+
+  exmap ml; ml[pbasis.get_var(dir)] = -1;
+  exmap mr; mr[pbasis.get_var(dir)] = 1;
+  ex alpha_l = (alpha_expand(pbasis, alpha, als, dir).subs(mr)
+    + alpha_expand(pbasis, alpha, acs, dir).subs(ml))/2;
+  ex alpha_r = (alpha_expand(pbasis, alpha, acs, dir).subs(mr)
+    + alpha_expand(pbasis, alpha, ars, dir).subs(ml))/2;
+
+  fc << "  double Ghat_l[" << ns << "], Ghat_r[" << ns << "];" << std::endl;
+
+  fc << "  {" << std::endl;
+  fc << "    double amax = 0.0;" << std::endl;
+  ex al = Gkyl::writeSurfAlpha(fc, "    ", sbasis, alpha_l.expand(), count);
+  lst flux_l = Gkyl::calcLaxFlux(sbasis, al,
+    Gkyl::faceExpand(pbasis, fls, dir, 1), Gkyl::faceExpand(pbasis, fcs, dir, -1));
+  count = Gkyl::addOps(count, Gkyl::writeAssign(fc, "    ", "Ghat_l", flux_l));
+  fc << "  }" << std::endl;
+
+  fc << "  {" << std::endl;
+  fc << "    double amax = 0.0;" << std::endl;
+  ex ar = Gkyl::writeSurfAlpha(fc, "    ", sbasis, alpha_r.expand(), count);
+  lst flux_r = Gkyl::calcLaxFlux(sbasis, ar,
+    Gkyl::faceExpand(pbasis, fcs, dir, 1), Gkyl::faceExpand(pbasis, frs, dir, -1));
+  count = Gkyl::addOps(count, Gkyl::writeAssign(fc, "    ", "Ghat_r", flux_r));
+  fc << "  }" << std::endl;
+  fc << std::endl;
+
+  count = Gkyl::addOps(count, Gkyl::writeLift(fc, "  ", pbasis, sbasis, dir, true, true));
+
+  // close function
+  fc << "}" << std::endl << std::endl;
+
+  Gkyl::writeOpCount(fh, fc, kn.str(), count);
+}
+
+void
+gen_all_gyrokinetic()
+{
+  // compute time-stamp
+  char buff[70];
+  time_t t = time(NULL);
+  struct tm curr_tm = *localtime(&t);
+  strftime(buff, sizeof buff, "%c", &curr_tm);
+
+  symbol z0("z0"), z1("z1"), z2("z2"), z3("z3"), z4("z4"), z5("z5");
+  std::vector<symbol> vars { z0, z1, z2, z3, z4, z5 };
+
+  std::ofstream gk_file_h("kernels/gyrokinetic/gkyl_gyrokinetic_kernels.h", std::ofstream::out);
+  gk_file_h << "// " << buff << std::endl;
+  gk_file_h << "#pragma once" << std::endl;
+  gk_file_h << "#include <gkyl_util.h>" << std::endl;
+  gk_file_h << "EXTERN_C_BEG" << std::endl;
+
+  struct timespec tstart = gkyl_wall_clock();
+
+  // same (cdim, vdim) pairs as the gkhyb basis
+  for (int cdim=1; cdim<=3; ++cdim) {
+    for (int vdim=std::min(cdim,2); vdim<=2; ++vdim) {
+      int p = 1;
+      std::cout << cdim << "x" << vdim << "v" << "p" << p << " " << std::flush;
+      Gkyl::ModalBasis cbasis(Gkyl::MODAL_SER, cdim, 0, vars, p);
+      Gkyl::ModalBasis pbasis(Gkyl::MODAL_GKHYB, cdim+vdim, vdim, vars, p);
+
+      // characteristic velocities are shared by all kernels
+      std::vector<lst> alpha = calc_gk_alpha(cbasis, pbasis);
+
+      std::ostringstream suffix;
+      suffix << "_" << cdim << "x" << vdim << "v_gkhyb_" << "p" << p << ".c";
+
+      // each function is written to its own file to allow building
+      // kernels in parallel
+      std::ofstream alpha_file_c(("kernels/gyrokinetic/gyrokinetic_alpha" + suffix.str()).c_str(), std::ofstream::out);
+      alpha_file_c << "// " << buff << std::endl;
+      alpha_file_c << "#include <math.h>" << std::endl;
+      alpha_file_c << "#include <gkyl_gyrokinetic_kernels.h>" << std::endl;
+      gen_gk_alpha(gk_file_h, alpha_file_c, cbasis, pbasis, alpha);
+
+      std::ofstream vol_file_c(("kernels/gyrokinetic/gyrokinetic_vol" + suffix.str()).c_str(), std::ofstream::out);
+      vol_file_c << "// " << buff << std::endl;
+      vol_file_c << "#include <gkyl_gyrokinetic_kernels.h>" << std::endl;
+      gen_gk_vol(gk_file_h, vol_file_c, cbasis, pbasis, alpha);
+
+      // no flux in the magnetic moment direction
+      for (int dir=0; dir<=cdim; ++dir) {
+        std::ofstream surf_file_c(("kernels/gyrokinetic/gyrokinetic_surf" + dir_name(cdim, dir) + suffix.str()).c_str(),
+          std::ofstream::out);
+        surf_file_c << "// " << buff << std::endl;
+        surf_file_c << "#include <math.h>" << std::endl;
+        surf_file_c << "#include <gkyl_gyrokinetic_kernels.h>" << std::endl;
+        gen_gk_surf(gk_file_h, surf_file_c, cbasis, pbasis, alpha, dir);
+      }
+    }
+  }
+
+  gk_file_h << "EXTERN_C_END" << std::endl;
+
+  double tm = gkyl_time_diff_now_sec(tstart);
+  std::cout << "Took " << tm << " seconds" << std::endl;
+}
+
+int
+main(int argc, char **argv)
+{
+  gen_all_gyrokinetic();
+
+  return 1;
+}
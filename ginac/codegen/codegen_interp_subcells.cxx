@@ -0,0 +1,119 @@
+#include <modal_basis.h>
+#include <kernel_util.h>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <gkyl_util.h>
+
+using namespace GiNaC;
+
+// Generates kernel evaluating the expansion at the centers of a
+// uniform grid of k^ndim sub-cells of the cell, for writing data
+// interpolated to a finer grid. The sub-cell evaluation matrix is
+// applied sum-factorized, one direction at a time, with its 1D values
+// as constants. Values are stored with the sub-cell index in the first
+// direction varying slowest. Generated function signature:
+//
+// void foo(const double *f, double *fsub)
+//
+// fsub: k^ndim values
+//
+// fh: header file
+// fc: C file
+//
+static void
+gen_interp_to_subcells(std::ostream& fh, std::ostream& fc, const std::string& kn,
+  const Gkyl::ModalBasis& basis, int k)
+{
+  // 1D sub-cell centers
+  std::vector<numeric> x;
+  for (int i=0; i<k; ++i)
+    x.push_back(numeric(2*i+1, k) - 1);
+
+  // function declaration
+  fh << "GKYL_CU_DH void " << kn << "(const double *GKYL_RESTRICT f, double *GKYL_RESTRICT fsub);" << std::endl;
+
+  // function definition
+  fc << "GKYL_CU_DH" << std::endl;
+  fc << "void" << std::endl;
+  fc << kn << "(const double *GKYL_RESTRICT f, double *GKYL_RESTRICT fsub)" << std::endl;
+  fc << "{" << std::endl;
+  struct gkyl_kern_op_count count = Gkyl::writeTensorEval(fc, "  ", basis, x, "f", "fsub");
+  // close function
+  fc << "}" << std::endl << std::endl;
+
+  Gkyl::writeOpCount(fh, fc, kn, count);
+  fc << std::endl;
+}
+
+// Writes source file with the kernels for k = 2, ..., kmax
+static void
+gen_interp_file(std::ostream& fh, const char *buff, const std::string& suf,
+  const Gkyl::ModalBasis& basis, int kmax)
+{
+  // each basis is written to its own file to allow building kernels
+  // in parallel
+  std::ofstream interp_file_c(("kernels/interp/interp_to_subcells_" + suf + ".c").c_str(), std::ofstream::out);
+  interp_file_c << "// " << buff << std::endl;
+  interp_file_c << "#include <gkyl_interp_kernels.h>" << std::endl;
+
+  fh << std::endl;
+  for (int k=2; k<=kmax; ++k) {
+    std::ostringstream kn;
+    kn << "interp_to_subcells_" << suf << "_k" << k;
+    gen_interp_to_subcells(fh, interp_file_c, kn.str(), basis, k);
+  }
+}
+
+void
+gen_all_interp()
+{
+  // compute time-stamp
+  char buff[70];
+  time_t t = time(NULL);
+  struct tm curr_tm = *localtime(&t);
+  strftime(buff, sizeof buff, "%c", &curr_tm);
+
+  symbol z0("z0"), z1("z1"), z2("z2"), z3("z3"), z4("z4"), z5("z5");
+  std::vector<symbol> vars { z0, z1, z2, z3, z4, z5 };
+
+  std::ofstream interp_file_h("kernels/interp/gkyl_interp_kernels.h", std::ofstream::out);
+  interp_file_h << "// " << buff << std::endl;
+  interp_file_h << "#pragma once" << std::endl;
+  interp_file_h << "#include <gkyl_util.h>" << std::endl;
+  interp_file_h << "EXTERN_C_BEG" << std::endl;
+
+  struct timespec tstart = gkyl_wall_clock();
+
+  // up to 4 sub-cells per direction in conf-space, 2 in phase-space
+  for (int dim=1; dim<=6; ++dim) {
+    for (int p=1; p<=(dim<=3 ? 3 : 2); ++p) {
+      std::cout << dim << "dp" << p << " " << std::flush;
+      Gkyl::ModalBasis basis(Gkyl::MODAL_SER, dim, 0, vars, p);
+      std::ostringstream suf;
+      suf << dim << "d_ser_p" << p;
+      gen_interp_file(interp_file_h, buff, suf.str(), basis, dim<=3 ? 4 : 2);
+    }
+  }
+  for (int dim=2; dim<=5; ++dim) {
+    std::cout << dim << "dp2 (tensor) " << std::flush;
+    Gkyl::ModalBasis basis(Gkyl::MODAL_TEN, dim, 0, vars, 2);
+    std::ostringstream suf;
+    suf << dim << "d_tensor_p2";
+    gen_interp_file(interp_file_h, buff, suf.str(), basis, dim<=3 ? 4 : 2);
+  }
+  std::cout << std::endl;
+
+  interp_file_h << "EXTERN_C_END" << std::endl;
+
+  double tm = gkyl_time_diff_now_sec(tstart);
+  std::cout << "Took " << tm << " seconds" << std::endl;
+}
+
+int
+main(int argc, char **argv)
+{
+  gen_all_interp();
+
+  return 1;
+}
@@ -0,0 +1,359 @@
+#include <modal_basis.h>
+#include <kernel_util.h>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <gkyl_util.h>
+
+using namespace GiNaC;
+
+static const char *vlasov_dir_names[] = { "vx", "vy", "vz" };
+static const char *gk_dir_names[] = { "vpar", "mu" };
+
+// Name of kernel 'op' for basis
+static std::string
+kernel_name(bool is_gk, const std::string& op, int cdim, int vdim, int polyOrder)
+{
+  std::ostringstream kn;
+  kn << "lbo_" << (is_gk ? "gyrokinetic_" : "vlasov_") << op
+     << "_" << cdim << "x" << vdim << "v_" << (is_gk ? "gkhyb" : "hyb") << "_p" << polyOrder;
+  return kn.str();
+}
+
+// Arguments common to all kernels, before the distribution function
+static std::string
+common_args(bool is_gk)
+{
+  if (is_gk)
+    return "const double *w, const double *dxv, double m_, const double *bmag_inv, const double *nuSum, const double *nuUSum, const double *nuVtSqSum";
+  return "const double *w, const double *dxv, const double *nuSum, const double *nuUSum, const double *nuVtSqSum";
+}
+
+// Highest power of z_dir in the basis
+static int
+dir_degree(const Gkyl::ModalBasis& pbasis, int dir)
+{
+  symbol f("f");
+  return pbasis.expand(f).expand().degree(pbasis.get_var(dir));
+}
+
+// Computes the drag coefficient a and diffusion coefficient d of the
+// Lenard-Bernstein operator df/dt = d/dz (a*f + d*df/dz) in velocity
+// direction j, in logical coordinates. For Vlasov
+//
+// a = 2/dv*(nu*v_j - nuU_j), d = 4/dv^2*nuVtSq
+//
+// and for gyrokinetics the parallel direction has the same form with
+// the parallel flow, while the magnetic moment direction has
+//
+// a = 2/dmu*2*nu*mu, d = 4/dmu^2*2*m*mu*nuVtSq/B
+//
+static void
+calc_lbo_coeff(bool is_gk, int j, const Gkyl::ModalBasis& cbasis, const Gkyl::ModalBasis& pbasis,
+  ex& a, ex& d)
+{
+  int cdim = cbasis.get_ndim();
+  symbol w("w"), dxv("dxv"), m_("m_"), bmag_inv("bmag_inv");
+  symbol nuSum("nuSum"), nuUSum("nuUSum"), nuVtSqSum("nuVtSqSum");
+
+  int dir = cdim+j;
+  ex rdx2 = 2/indexed(dxv, idx(dir,1));
+  ex v = indexed(w, idx(dir,1)) + indexed(dxv, idx(dir,1))/2*pbasis.get_var(dir);
+  ex nu = Gkyl::confExpand(cbasis, nuSum, 0), nuVtSq = Gkyl::confExpand(cbasis, nuVtSqSum, 0);
+
+  if (is_gk && j == 1) {
+    a = rdx2*2*nu*v;
+    d = rdx2*rdx2*2*m_*v*nuVtSq*Gkyl::confExpand(cbasis, bmag_inv, 0);
+  }
+  else {
+    a = rdx2*(nu*v - Gkyl::confExpand(cbasis, nuUSum, j));
+    d = rdx2*rdx2*nuVtSq;
+  }
+}
+
+// Writes projection of coefficient c on basis into array name[]
+// (starting at index off) and returns expansion of c in terms of the
+// array. Only non-zero coefficients are written.
+static ex
+write_coeff(std::ostream& fc, const std::string& indent, const Gkyl::ModalBasis& basis,
+  const std::string& name, int off, const ex& c, struct gkyl_kern_op_count& count)
+{
+  symbol s(name);
+  lst bc = basis.get_basis();
+  lst cc = basis.project(c);
+  ex e = 0;
+  for (int k=0; k<basis.get_numbasis(); ++k) {
+    if (cc[k].is_zero()) continue;
+    auto ck = cc[k].evalf();
+    fc << indent << name << "[" << off+k << "] = " << csrc << ck << ";" << std::endl;
+    count = Gkyl::addOps(count, Gkyl::countOps(ck));
+    e += bc[k]*indexed(s, idx(off+k,1));
+  }
+  return e;
+}
+
+// Generates fused drag+diffusion LBO volume kernel. The drag and
+// diffusion coefficients are projected once from the nu, nu*u and
+// nu*vtSq expansions and both terms are accumulated in a single pass
+// over f. The diffusion term is integrated by parts twice, so the
+// volume contribution is < d/dz (d*db_l/dz), f >. Generated function
+// signature:
+//
+// double foo(const double *w, const double *dxv, [double m_, const double *bmag_inv,]
+//   const double *nuSum, const double *nuUSum, const double *nuVtSqSum, const double *f, double *out)
+//
+// The bracketed arguments are present only for gyrokinetics.
+//
+// Returns estimate of the CFL frequency at the cell-center.
+//
+// fh: header file
+// fc: C file
+//
+static void
+gen_lbo_vol(std::ostream& fh, std::ostream& fc, bool is_gk,
+  const Gkyl::ModalBasis& cbasis, const Gkyl::ModalBasis& pbasis)
+{
+  int cdim = cbasis.get_ndim(), pdim = pbasis.get_ndim(), vdim = pdim-cdim;
+  int polyOrder = pbasis.get_polyOrder(), np = pbasis.get_numbasis();
+  lst bc = pbasis.get_basis();
+
+  std::string kn = kernel_name(is_gk, "vol", cdim, vdim, polyOrder);
+  std::string args = "(" + common_args(is_gk) + ", const double *f, double *GKYL_RESTRICT out )";
+
+  // function declaration
+  fh << std::endl << "GKYL_CU_DH double " << kn << args << ";" << std::endl;
+
+  // function definition
+  fc << "GKYL_CU_DH" << std::endl;
+  fc << "double" << std::endl;
+  fc << kn << args << std::endl;
+  fc << "{" << std::endl;
+
+  struct gkyl_kern_op_count count = { 0 };
+  symbol f("f");
+  exmap center;
+  for (int d=0; d<pdim; ++d) center[pbasis.get_var(d)] = 0;
+
+  fc << "  double alphaDrag[" << vdim*np << "], alphaDiff[" << vdim*np << "];" << std::endl;
+  fc << "  double cflFreq_mid = 0.0;" << std::endl;
+  std::vector<ex> a_expand(vdim), d_expand(vdim);
+  for (int j=0; j<vdim; ++j) {
+    ex a, d;
+    calc_lbo_coeff(is_gk, j, cbasis, pbasis, a, d);
+    a_expand[j] = write_coeff(fc, "  ", pbasis, "alphaDrag", j*np, a, count);
+    d_expand[j] = write_coeff(fc, "  ", pbasis, "alphaDiff", j*np, d, count);
+
+    int pd = dir_degree(pbasis, cdim+j);
+    auto amid = a_expand[j].subs(center).expand().evalf();
+    auto dmid = d_expand[j].subs(center).expand().evalf();
+    fc << "  cflFreq_mid += " << 2*pd+1 << "*fabs(" << csrc << amid << ") + "
+       << (pd+1)*(pd+1) << "*fabs(" << csrc << dmid << ");" << std::endl;
+    count = Gkyl::addOps(count, Gkyl::addOps(Gkyl::countOps(amid), Gkyl::countOps(dmid)));
+    count.num_sum += 2; count.num_prod += 2;
+  }
+
+  // out_l = sum_j -< db_l/dz_j, a_j f > + < d/dz_j (d_j db_l/dz_j), f >
+  lst fsym, outs;
+  for (int m=0; m<np; ++m)
+    fsym.append( indexed(f, idx(m,1)) );
+  for (int l=0; l<np; ++l) {
+    ex out = 0;
+    for (int j=0; j<vdim; ++j) {
+      const symbol& z = pbasis.get_var(cdim+j);
+      ex db = GiNaC::diff(bc[l], z);
+      if (db.is_zero()) continue;
+      lst proj_l = pbasis.project(-db*a_expand[j] + GiNaC::diff(d_expand[j]*db, z));
+      for (int m=0; m<np; ++m)
+        out += proj_l[m]*fsym[m];
+    }
+    outs.append(out.expand());
+  }
+  count = Gkyl::addOps(count, Gkyl::writeIncrCSE(fc, outs, fsym));
+  fc << std::endl;
+
+  fc << "  return cflFreq_mid;" << std::endl;
+  // close function
+  fc << "}" << std::endl << std::endl;
+
+  Gkyl::writeOpCount(fh, fc, kn, count);
+}
+
+// Writes the numerical fluxes on the face between a left cell with
+// expansion fm and a right cell with expansion fp. Ghat_X is the
+// Lax-Friedrichs drag flux plus the diffusive flux d*dg/dz of the
+// recovery polynomial g, and Gdiff_X is d*g on the face, needed by the
+// second integration by parts.
+static void
+write_face_flux(std::ostream& fc, const std::string& X, const Gkyl::ModalBasis& pbasis,
+  const Gkyl::ModalBasis& sbasis, int dir, const ex& a_face, const ex& d_face,
+  const ex& fm, const ex& fp, struct gkyl_kern_op_count& count)
+{
+  const symbol& z = pbasis.get_var(dir);
+  exmap mz; mz[z] = 0;
+
+  fc << "  {" << std::endl;
+  fc << "    double amax = 0.0;" << std::endl;
+  ex alpha = Gkyl::writeSurfAlpha(fc, "    ", sbasis, (-a_face).expand(), count);
+  fc << "    double diff[" << sbasis.get_numbasis() << "];" << std::endl;
+  ex dexp = write_coeff(fc, "    ", sbasis, "diff", 0, d_face.expand(), count);
+
+  ex g = Gkyl::recoverFace(pbasis, dir, fm, fp);
+  ex g0 = g.subs(mz), dg0 = GiNaC::diff(g, z).subs(mz);
+
+  exmap mr; mr[z] = 1;
+  exmap ml; ml[z] = -1;
+  lst lax = Gkyl::calcLaxFlux(sbasis, alpha, fm.subs(mr).expand(), fp.subs(ml).expand());
+  lst dflux = sbasis.project(dexp*dg0);
+  lst ghat;
+  for (int k=0; k<sbasis.get_numbasis(); ++k)
+    ghat.append(lax[k] - dflux[k]);
+  count = Gkyl::addOps(count, Gkyl::writeAssign(fc, "    ", "Ghat_" + X, ghat));
+  count = Gkyl::addOps(count, Gkyl::writeAssign(fc, "    ", "Gdiff_" + X, sbasis.project(dexp*g0)));
+  fc << "  }" << std::endl;
+}
+
+// Generates fused drag+diffusion LBO surface kernel in velocity
+// direction cdim+j. Both faces of the cell are handled, with the
+// drag flux upwinded using a Lax-Friedrichs penalty and the
+// diffusive flux computed from the recovery polynomial across each
+// face. Generated function signature:
+//
+// void foo(const double *w, const double *dxv, [double m_, const double *bmag_inv,]
+//   const double *nuSum, const double *nuUSum, const double *nuVtSqSum,
+//   const double *fl, const double *fc, const double *fr, double *out)
+//
+// fh: header file
+// fc: C file
+//
+static void
+gen_lbo_surf(std::ostream& fh, std::ostream& fc, bool is_gk,
+  const Gkyl::ModalBasis& cbasis, const Gkyl::ModalBasis& pbasis, int j)
+{
+  int cdim = cbasis.get_ndim(), pdim = pbasis.get_ndim(), vdim = pdim-cdim;
+  int polyOrder = pbasis.get_polyOrder(), dir = cdim+j;
+
+  std::string kn = kernel_name(is_gk,
+    std::string("surf") + (is_gk ? gk_dir_names[j] : vlasov_dir_names[j]), cdim, vdim, polyOrder);
+  std::string args = "(" + common_args(is_gk)
+    + ", const double *fl, const double *fc, const double *fr, double *GKYL_RESTRICT out )";
+
+  // function declaration
+  fh << std::endl << "GKYL_CU_DH void " << kn << args << ";" << std::endl;
+
+  // function definition
+  fc << "GKYL_CU_DH" << std::endl;
+  fc << "void" << std::endl;
+  fc << kn << args << std::endl;
+  fc << "{" << std::endl;
+
+  struct gkyl_kern_op_count count = { 0 };
+  symbol fls("fl"), fcs("fc"), frs("fr");
+  Gkyl::ModalBasis sbasis = pbasis.surfBasis(dir);
+  int ns = sbasis.get_numbasis();
+  lst bc = pbasis.get_basis();
+
+  ex a, d;
+  calc_lbo_coeff(is_gk, j, cbasis, pbasis, a, d);
+  exmap ml; ml[pbasis.get_var(dir)] = -1;
+  exmap mr; mr[pbasis.get_var(dir)] = 1;
+
+  fc << "  double Ghat_l[" << ns << "], Ghat_r[" << ns << "];" << std::endl;
+  fc << "  double Gdiff_l[" << ns << "], Gdiff_r[" << ns << "];" << std::endl;
+  write_face_flux(fc, "l", pbasis, sbasis, dir, a.subs(ml), d.subs(ml),
+    pbasis.expand(fls), pbasis.expand(fcs), count);
+  write_face_flux(fc, "r", pbasis, sbasis, dir, a.subs(mr), d.subs(mr),
+    pbasis.expand(fcs), pbasis.expand(frs), count);
+  fc << std::endl;
+
+  count = Gkyl::addOps(count, Gkyl::writeLift(fc, "  ", pbasis, sbasis, dir, true, true));
+
+  // second integration by parts of the diffusion term:
+  // out_i -= [ db_i/dz d*g ] from z=-1 to z=+1
+  symbol gdiff_l("Gdiff_l"), gdiff_r("Gdiff_r");
+  for (int i=0; i<pbasis.get_numbasis(); ++i) {
+    ex db = GiNaC::diff(bc[i], pbasis.get_var(dir));
+    if (db.is_zero()) continue;
+    lst cl = sbasis.project(db.subs(ml)), cr = sbasis.project(db.subs(mr));
+    ex out = 0;
+    for (int k=0; k<ns; ++k)
+      out += cl[k]*indexed(gdiff_l, idx(k,1)) - cr[k]*indexed(gdiff_r, idx(k,1));
+    out = out.expand().evalf();
+    if (out.is_zero()) continue;
+    fc << "  out[" << i << "] += " << csrc << out << ";" << std::endl;
+    count = Gkyl::addOps(count, Gkyl::countOps(out));
+    count.num_sum += 1;
+  }
+
+  // close function
+  fc << "}" << std::endl << std::endl;
+
+  Gkyl::writeOpCount(fh, fc, kn, count);
+}
+
+// Generates volume and surface kernels for one model. Vlasov uses the
+// hybrid basis, gyrokinetics the gkhyb basis.
+static void
+gen_all_lbo_model(bool is_gk)
+{
+  // compute time-stamp
+  char buff[70];
+  time_t t = time(NULL);
+  struct tm curr_tm = *localtime(&t);
+  strftime(buff, sizeof buff, "%c", &curr_tm);
+
+  symbol z0("z0"), z1("z1"), z2("z2"), z3("z3"), z4("z4"), z5("z5");
+  std::vector<symbol> vars { z0, z1, z2, z3, z4, z5 };
+
+  std::string hn = is_gk ? "gkyl_lbo_gyrokinetic_kernels.h" : "gkyl_lbo_vlasov_kernels.h";
+  std::ofstream lbo_file_h(("kernels/lbo/" + hn).c_str(), std::ofstream::out);
+  lbo_file_h << "// " << buff << std::endl;
+  lbo_file_h << "#pragma once" << std::endl;
+  lbo_file_h << "#include <gkyl_util.h>" << std::endl;
+  lbo_file_h << "EXTERN_C_BEG" << std::endl;
+
+  struct timespec tstart = gkyl_wall_clock();
+
+  for (int cdim=1; cdim<=3; ++cdim) {
+    int vmin = is_gk ? std::min(cdim,2) : cdim, vmax = is_gk ? 2 : 3;
+    for (int vdim=vmin; vdim<=vmax; ++vdim) {
+      int p = 1;
+      std::cout << cdim << "x" << vdim << "v" << "p" << p << " " << std::flush;
+      Gkyl::ModalBasis cbasis(Gkyl::MODAL_SER, cdim, 0, vars, p);
+      Gkyl::ModalBasis pbasis(is_gk ? Gkyl::MODAL_GKHYB : Gkyl::MODAL_HYB, cdim+vdim, vdim, vars, p);
+
+      // each function is written to its own file to allow building
+      // kernels in parallel
+      std::string vn = kernel_name(is_gk, "vol", cdim, vdim, p);
+      std::ofstream vol_file_c(("kernels/lbo/" + vn + ".c").c_str(), std::ofstream::out);
+      vol_file_c << "// " << buff << std::endl;
+      vol_file_c << "#include <math.h>" << std::endl;
+      vol_file_c << "#include <" << hn << ">" << std::endl;
+      gen_lbo_vol(lbo_file_h, vol_file_c, is_gk, cbasis, pbasis);
+
+      for (int j=0; j<vdim; ++j) {
+        std::string sn = kernel_name(is_gk,
+          std::string("surf") + (is_gk ? gk_dir_names[j] : vlasov_dir_names[j]), cdim, vdim, p);
+        std::ofstream surf_file_c(("kernels/lbo/" + sn + ".c").c_str(), std::ofstream::out);
+        surf_file_c << "// " << buff << std::endl;
+        surf_file_c << "#include <math.h>" << std::endl;
+        surf_file_c << "#include <" << hn << ">" << std::endl;
+        gen_lbo_surf(lbo_file_h, surf_file_c, is_gk, cbasis, pbasis, j);
+      }
+    }
+  }
+  std::cout << std::endl;
+
+  lbo_file_h << "EXTERN_C_END" << std::endl;
+
+  double tm = gkyl_time_diff_now_sec(tstart);
+  std::cout << "Took " << tm << " seconds" << std::endl;
+}
+
+int
+main(int argc, char **argv)
+{
+  gen_all_lbo_model(false);
+  gen_all_lbo_model(true);
+
+  return 1;
+}
@@ -0,0 +1,399 @@
+#include <modal_basis.h>
+#include <kernel_util.h>
+#include <iostream>
+#include <memory>
+#include <fstream>
+#include <sstream>
+#include <gkyl_util.h>
+
+using namespace GiNaC;
+
+static const char *dir_names[] = { "x", "y", "z" };
+
+// Number of components: Ex, Ey, Ez, Bx, By, Bz, phi, psi
+static const int NCOMP = 8;
+
+static std::string
+basis_name(Gkyl::ModalBasisType type)
+{
+  return type == Gkyl::MODAL_TEN ? "tensor" : "ser";
+}
+
+// Name of Maxwell kernel 'op'
+static std::string
+kernel_name(const std::string& bn, const std::string& op, int ndim, int polyOrder)
+{
+  std::ostringstream kn;
+  kn << "maxwell_" << op << "_" << ndim << "d_" << bn << "_p" << polyOrder;
+  return kn.str();
+}
+
+// Flux of the perfectly-hyperbolic Maxwell equations in direction
+// dir. Each component c has flux coef[c]*q[src[c]], and the pairs
+// (c, src[c]) propagate with speed speed[c]. The coefficients and
+// speeds are in terms of the symbols c, chi_e and chi_m.
+struct maxwell_flux {
+  int src[NCOMP];
+  ex coef[NCOMP];
+  ex speed[NCOMP];
+};
+
+static maxwell_flux
+calc_maxwell_flux(int dir)
+{
+  symbol c("c"), chi_e("chi_e"), chi_m("chi_m");
+  ex c2 = c*c;
+
+  // components along, and the two transverse to, the direction
+  int d0 = dir, d1 = (dir+1)%3, d2 = (dir+2)%3;
+  int Ed0 = d0, Ed1 = d1, Ed2 = d2, Bd0 = 3+d0, Bd1 = 3+d1, Bd2 = 3+d2, phi = 6, psi = 7;
+
+  maxwell_flux fl;
+  fl.src[Ed0] = phi; fl.coef[Ed0] = c2*chi_e; fl.speed[Ed0] = chi_e*c;
+  fl.src[Ed1] = Bd2; fl.coef[Ed1] = c2; fl.speed[Ed1] = c;
+  fl.src[Ed2] = Bd1; fl.coef[Ed2] = -c2; fl.speed[Ed2] = c;
+  fl.src[Bd0] = psi; fl.coef[Bd0] = chi_m; fl.speed[Bd0] = chi_m*c;
+  fl.src[Bd1] = Ed2; fl.coef[Bd1] = -1; fl.speed[Bd1] = c;
+  fl.src[Bd2] = Ed1; fl.coef[Bd2] = 1; fl.speed[Bd2] = c;
+  fl.src[phi] = Ed0; fl.coef[phi] = chi_e; fl.speed[phi] = chi_e*c;
+  fl.src[psi] = Bd0; fl.coef[psi] = c2*chi_m; fl.speed[psi] = chi_m*c;
+  return fl;
+}
+
+// Expansion of component comp of q
+static ex
+comp_expand(const Gkyl::ModalBasis& basis, const symbol& q, int comp)
+{
+  int np = basis.get_numbasis();
+  lst bc = basis.get_basis();
+  ex e = 0;
+  for (int k=0; k<np; ++k)
+    e += bc[k]*indexed(q, idx(comp*np+k,1));
+  return e;
+}
+
+// Generates Maxwell volume kernel. In each direction the derivative
+// matrix <db_l/dz, b_m> is applied once to each component entering
+// the flux, and the result is added to the component it couples to.
+// Generated function signature:
+//
+// double foo(double c, double chi_e, double chi_m, const double *dx, const double *q, double *out)
+//
+// c: speed of light
+// chi_e, chi_m: speed factors for electric and magnetic divergence cleaning
+// q: components (Ex,Ey,Ez,Bx,By,Bz,phi,psi), each expanded in basis
+//
+// Returns estimate of the CFL frequency.
+//
+// fh: header file
+// fc: C file
+//
+static void
+gen_maxwell_vol(Gkyl::ModalBasisType type, std::ostream& fh, std::ostream& fc,
+  const Gkyl::ModalBasis& basis)
+{
+  int ndim = basis.get_ndim(), polyOrder = basis.get_polyOrder(), np = basis.get_numbasis();
+  lst bc = basis.get_basis();
+  std::string kn = kernel_name(basis_name(type), "vol", ndim, polyOrder);
+  std::string args =
+    "(double c, double chi_e, double chi_m, const double *dx, const double *q, double *GKYL_RESTRICT out )";
+
+  // function declaration
+  fh << std::endl << "GKYL_CU_DH double " << kn << args << ";" << std::endl;
+
+  // function definition
+  fc << "GKYL_CU_DH" << std::endl;
+  fc << "double" << std::endl;
+  fc << kn << args << std::endl;
+  fc << "{" << std::endl;
+
+  struct gkyl_kern_op_count count = { 0 };
+  symbol q("q");
+
+  fc << "  const double cmax = fmax(c, fmax(chi_e*c, chi_m*c));" << std::endl;
+  fc << "  double cflFreq = 0.0;" << std::endl;
+  fc << "  double dq[" << np << "], fac;" << std::endl;
+  count.num_prod += 2;
+
+  for (int d=0; d<ndim; ++d) {
+    const symbol& z = basis.get_var(d);
+    maxwell_flux fl = calc_maxwell_flux(d);
+
+    fc << std::endl;
+    fc << "  // " << dir_names[d] << " direction" << std::endl;
+    fc << "  const double rdx2" << dir_names[d] << " = 2.0/dx[" << d << "];" << std::endl;
+    fc << "  cflFreq += " << 2*polyOrder+1 << "*cmax*rdx2" << dir_names[d] << ";" << std::endl;
+    count.num_prod += 3; count.num_sum += 1;
+
+    // derivative matrix D[l][m] = < db_l/dz, b_m >
+    std::vector<lst> D(np);
+    bool has_vol = false;
+    for (int l=0; l<np; ++l) {
+      lst Dl;
+      ex dbl = GiNaC::diff(bc[l], z);
+      for (int m=0; m<np; ++m) {
+        Dl.append(basis.innerProd(dbl, bc[m]));
+        if (!Dl[m].is_zero()) has_vol = true;
+      }
+      D[l] = Dl;
+    }
+    if (!has_vol) continue;
+
+    for (int cc=0; cc<NCOMP; ++cc) {
+      int s = fl.src[cc];
+      for (int l=0; l<np; ++l) {
+        ex dql = 0;
+        for (int m=0; m<np; ++m)
+          dql += D[l][m]*indexed(q, idx(s*np+m,1));
+        dql = dql.evalf();
+        if (dql.is_zero()) continue;
+        fc << "  dq[" << l << "] = " << csrc << dql << ";" << std::endl;
+        count = Gkyl::addOps(count, Gkyl::countOps(dql));
+      }
+      auto fe = (fl.coef[cc]*symbol("rdx2" + std::string(dir_names[d]))).evalf();
+      fc << "  fac = " << csrc << fe << ";" << std::endl;
+      count = Gkyl::addOps(count, Gkyl::countOps(fe));
+      for (int l=0; l<np; ++l) {
+        bool is_zero = true;
+        for (int m=0; m<np; ++m)
+          if (!D[l][m].is_zero()) is_zero = false;
+        if (is_zero) continue;
+        fc << "  out[" << cc*np+l << "] += fac*dq[" << l << "];" << std::endl;
+        count.num_sum += 1; count.num_prod += 1;
+      }
+    }
+  }
+  fc << std::endl;
+
+  fc << "  return cflFreq;" << std::endl;
+  // close function
+  fc << "}" << std::endl << std::endl;
+
+  Gkyl::writeOpCount(fh, fc, kn, count);
+}
+
+// Writes upwind fluxes of all components on the face between left
+// state qm and right state qp into Ghat_X[comp*ns+k]. The flux of each
+// component is the central flux of its partner minus speed/2 times
+// its own jump, which is the exact Riemann solution of the
+// component-coupled linear system.
+static struct gkyl_kern_op_count
+write_face_flux(std::ostream& fc, const std::string& X, const Gkyl::ModalBasis& basis,
+  const Gkyl::ModalBasis *sbasis, int dir, const symbol& qm, const symbol& qp)
+{
+  struct gkyl_kern_op_count count = { 0 };
+  maxwell_flux fl = calc_maxwell_flux(dir);
+  symbol rdx2("rdx2");
+  exmap ml; ml[basis.get_var(dir)] = -1;
+  exmap mr; mr[basis.get_var(dir)] = 1;
+
+  lst ghat;
+  for (int cc=0; cc<NCOMP; ++cc) {
+    int s = fl.src[cc];
+    ex avg = (comp_expand(basis, qm, s).subs(mr) + comp_expand(basis, qp, s).subs(ml))/2;
+    ex jump = comp_expand(basis, qp, cc).subs(ml) - comp_expand(basis, qm, cc).subs(mr);
+    lst g = Gkyl::faceProject(sbasis, (rdx2*(fl.coef[cc]*avg - fl.speed[cc]/2*jump)).expand());
+    for (size_t k=0; k<g.nops(); ++k)
+      ghat.append(g[k]);
+  }
+  count = Gkyl::addOps(count, Gkyl::writeAssign(fc, "  ", "Ghat_" + X, ghat));
+  return count;
+}
+
+// Generates Maxwell surface kernel in direction dir, updating all
+// components from the upwind fluxes on both faces of the cell.
+// Generated function signature:
+//
+// double foo(double c, double chi_e, double chi_m, const double *dx,
+//   const double *ql, const double *qc, const double *qr, double *out)
+//
+// Returns 0.0 (the CFL frequency is computed by the volume kernel).
+//
+// fh: header file
+// fc: C file
+//
+static void
+gen_maxwell_surf(Gkyl::ModalBasisType type, std::ostream& fh, std::ostream& fc,
+  const Gkyl::ModalBasis& basis, int dir)
+{
+  int ndim = basis.get_ndim(), polyOrder = basis.get_polyOrder(), np = basis.get_numbasis();
+  lst bc = basis.get_basis();
+  std::string kn = kernel_name(basis_name(type), std::string("surf") + dir_names[dir], ndim, polyOrder);
+  std::string args =
+    "(double c, double chi_e, double chi_m, const double *dx, const double *ql, const double *qc, const double *qr, double *GKYL_RESTRICT out )";
+
+  // function declaration
+  fh << std::endl << "GKYL_CU_DH double " << kn << args << ";" << std::endl;
+
+  // function definition
+  fc << "GKYL_CU_DH" << std::endl;
+  fc << "double" << std::endl;
+  fc << kn << args << std::endl;
+  fc << "{" << std::endl;
+
+  struct gkyl_kern_op_count count = { 0 };
+  symbol qls("ql"), qcs("qc"), qrs("qr"), ghat_l("Ghat_l"), ghat_r("Ghat_r");
+  const symbol& z = basis.get_var(dir);
+
+  // surface basis, or none in 1D where the face is a point
+  std::unique_ptr<Gkyl::ModalBasis> sbasis;
+  if (ndim > 1)
+    sbasis.reset(new Gkyl::ModalBasis(basis.surfBasis(dir)));
+  int ns = sbasis ? sbasis->get_numbasis() : 1;
+
+  fc << "  const double rdx2 = 2.0/dx[" << dir << "];" << std::endl;
+  fc << "  double Ghat_l[" << NCOMP*ns << "], Ghat_r[" << NCOMP*ns << "];" << std::endl;
+  count = Gkyl::addOps(count, write_face_flux(fc, "l", basis, sbasis.get(), dir, qls, qcs));
+  count = Gkyl::addOps(count, write_face_flux(fc, "r", basis, sbasis.get(), dir, qcs, qrs));
+  fc << std::endl;
+
+  // lift: out_i += b_i(z=-1).Ghat_l - b_i(z=+1).Ghat_r, the same
+  // surface weights for every component
+  exmap ml; ml[z] = -1;
+  exmap mr; mr[z] = 1;
+  for (int i=0; i<np; ++i) {
+    lst cl = Gkyl::faceProject(sbasis.get(), bc[i].subs(ml));
+    lst cr = Gkyl::faceProject(sbasis.get(), bc[i].subs(mr));
+    for (int cc=0; cc<NCOMP; ++cc) {
+      ex out = 0;
+      for (int k=0; k<ns; ++k)
+        out += cl[k]*indexed(ghat_l, idx(cc*ns+k,1)) - cr[k]*indexed(ghat_r, idx(cc*ns+k,1));
+      out = out.expand().evalf();
+      if (out.is_zero()) continue;
+      fc << "  out[" << cc*np+i << "] += " << csrc << out << ";" << std::endl;
+      count = Gkyl::addOps(count, Gkyl::countOps(out));
+      count.num_sum += 1;
+    }
+  }
+  fc << std::endl;
+  fc << "  return 0.0;" << std::endl;
+
+  // close function
+  fc << "}" << std::endl << std::endl;
+
+  Gkyl::writeOpCount(fh, fc, kn, count);
+}
+
+// Generates batched variants of the volume and surface kernels, which
+// update ncells cells in one call. For the volume kernel the cells are
+// consecutive in memory. For the surface kernel the cells are
+// consecutive along dir and stride is the distance (in doubles)
+// between neighbouring cells along dir, so that any direction of a
+// range can be swept; the cells just before the first and just after
+// the last one must be valid (ghost cells). Each cell holds 8*np
+// values. Generated function signatures:
+//
+// double foo_batch(double c, double chi_e, double chi_m, const double *dx, int ncells, const double *q, double *out)
+// double foo_batch(double c, double chi_e, double chi_m, const double *dx, int ncells, long stride, const double *q, double *out)
+//
+// Returns the largest CFL frequency of the cells.
+//
+// fh: header file
+// fc: C file
+//
+static void
+gen_maxwell_batch(std::ostream& fh, std::ostream& fc, const std::string& kn, int np, bool is_surf)
+{
+  std::string args = is_surf ?
+    "(double c, double chi_e, double chi_m, const double *dx, int ncells, long stride, const double *q, double *GKYL_RESTRICT out )" :
+    "(double c, double chi_e, double chi_m, const double *dx, int ncells, const double *q, double *GKYL_RESTRICT out )";
+
+  // function declaration
+  fh << std::endl << "GKYL_CU_DH double " << kn << "_batch" << args << ";" << std::endl;
+
+  // function definition
+  fc << "GKYL_CU_DH" << std::endl;
+  fc << "double" << std::endl;
+  fc << kn << "_batch" << args << std::endl;
+  fc << "{" << std::endl;
+  fc << "  double cflFreq = 0.0;" << std::endl;
+  fc << "  for (int i=0; i<ncells; ++i) {" << std::endl;
+  if (is_surf)
+    fc << "    double cfl = " << kn << "(c, chi_e, chi_m, dx, q+(i-1)*stride, q+i*stride, q+(i+1)*stride, out+i*stride);" << std::endl;
+  else
+    fc << "    double cfl = " << kn << "(c, chi_e, chi_m, dx, q+i*" << NCOMP*np
+       << ", out+i*" << NCOMP*np << ");" << std::endl;
+  fc << "    cflFreq = fmax(cflFreq, cfl);" << std::endl;
+  fc << "  }" << std::endl;
+  fc << "  return cflFreq;" << std::endl;
+  fc << "}" << std::endl << std::endl;
+}
+
+// Generates volume and surface kernels for basis
+static void
+gen_maxwell_basis(Gkyl::ModalBasisType type, std::ostream& fh, const char *buff,
+  const Gkyl::ModalBasis& basis)
+{
+  std::string bn = basis_name(type);
+  int ndim = basis.get_ndim(), p = basis.get_polyOrder(), np = basis.get_numbasis();
+
+  // each function is written to its own file to allow building
+  // kernels in parallel
+  std::string vn = kernel_name(bn, "vol", ndim, p);
+  std::ofstream vol_file_c(("kernels/maxwell/" + vn + ".c").c_str(), std::ofstream::out);
+  vol_file_c << "// " << buff << std::endl;
+  vol_file_c << "#include <math.h>" << std::endl;
+  vol_file_c << "#include <gkyl_maxwell_kernels.h>" << std::endl;
+  gen_maxwell_vol(type, fh, vol_file_c, basis);
+  gen_maxwell_batch(fh, vol_file_c, vn, np, false);
+
+  for (int dir=0; dir<ndim; ++dir) {
+    std::string sn = kernel_name(bn, std::string("surf") + dir_names[dir], ndim, p);
+    std::ofstream surf_file_c(("kernels/maxwell/" + sn + ".c").c_str(), std::ofstream::out);
+    surf_file_c << "// " << buff << std::endl;
+    surf_file_c << "#include <math.h>" << std::endl;
+    surf_file_c << "#include <gkyl_maxwell_kernels.h>" << std::endl;
+    gen_maxwell_surf(type, fh, surf_file_c, basis, dir);
+    gen_maxwell_batch(fh, surf_file_c, sn, np, true);
+  }
+}
+
+void
+gen_all_maxwell()
+{
+  // compute time-stamp
+  char buff[70];
+  time_t t = time(NULL);
+  struct tm curr_tm = *localtime(&t);
+  strftime(buff, sizeof buff, "%c", &curr_tm);
+
+  symbol z0("z0"), z1("z1"), z2("z2"), z3("z3"), z4("z4"), z5("z5");
+  std::vector<symbol> vars { z0, z1, z2, z3, z4, z5 };
+
+  std::ofstream maxwell_file_h("kernels/maxwell/gkyl_maxwell_kernels.h", std::ofstream::out);
+  maxwell_file_h << "// " << buff << std::endl;
+  maxwell_file_h << "#pragma once" << std::endl;
+  maxwell_file_h << "#include <gkyl_util.h>" << std::endl;
+  maxwell_file_h << "EXTERN_C_BEG" << std::endl;
+
+  struct timespec tstart = gkyl_wall_clock();
+
+  for (int dim=1; dim<=3; ++dim) {
+    for (int p=1; p<=3; ++p) {
+      std::cout << dim << "d" << "p" << p << " " << std::flush;
+      Gkyl::ModalBasis basis(Gkyl::MODAL_SER, dim, 0, vars, p);
+      gen_maxwell_basis(Gkyl::MODAL_SER, maxwell_file_h, buff, basis);
+    }
+  }
+  // tensor basis differs from serendipity only for p > 1
+  for (int dim=2; dim<=3; ++dim) {
+    int p = 2;
+    std::cout << dim << "d" << "p" << p << " (tensor) " << std::flush;
+    Gkyl::ModalBasis basis(Gkyl::MODAL_TEN, dim, 0, vars, p);
+    gen_maxwell_basis(Gkyl::MODAL_TEN, maxwell_file_h, buff, basis);
+  }
+  std::cout << std::endl;
+
+  maxwell_file_h << "EXTERN_C_END" << std::endl;
+
+  double tm = gkyl_time_diff_now_sec(tstart);
+  std::cout << "Took " << tm << " seconds" << std::endl;
+}
+
+int
+main(int argc, char **argv)
+{
+  gen_all_maxwell();
+
+  return 1;
+}
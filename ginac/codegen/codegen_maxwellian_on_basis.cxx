@@ -0,0 +1,184 @@
+#include <modal_basis.h>
+#include <kernel_util.h>
+#include <quadrature.h>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <gkyl_util.h>
+
+using namespace GiNaC;
+
+// Generates kernel projecting a Maxwellian with conf-space density,
+// drift and thermal speed squared on the phase basis. The moments are
+// evaluated at the distinct conf-space coordinates of the quadrature
+// nodes, the Maxwellian at each node, and the projection uses a
+// compile-time table in which the quadrature weights are folded into
+// the basis values. Generated function signature:
+//
+// void foo(const double *w, const double *dxv, const double *den, const double *udrift, const double *vtsq, double *f)
+//
+// den, vtsq: conf-space expansions
+// udrift: vdim components, each a conf-space expansion
+// f: projection of the Maxwellian (overwritten)
+//
+// fh: header file
+// fc: C file
+//
+static void
+gen_maxwellian_on_basis(std::ostream& fh, std::ostream& fc, const std::string& kn,
+  const Gkyl::ModalBasis& cbasis, const Gkyl::ModalBasis& pbasis, const Gkyl::QuadRule& quad)
+{
+  int cdim = cbasis.get_ndim(), pdim = pbasis.get_ndim(), vdim = pdim-cdim;
+  int nc = cbasis.get_numbasis(), np = pbasis.get_numbasis();
+  int nq = quad.get_numnodes();
+  const std::vector<std::vector<numeric> >& nodes = quad.get_nodes();
+  lst cbc = cbasis.get_basis(), bc = pbasis.get_basis();
+  std::string args =
+    "(const double *w, const double *dxv, const double *den, const double *udrift, const double *vtsq, double *GKYL_RESTRICT f )";
+
+  // function declaration
+  fh << std::endl << "GKYL_CU_DH void " << kn << args << ";" << std::endl;
+
+  // distinct conf-space coordinates of the nodes
+  Gkyl::QuadRule cquad(cdim);
+  std::vector<int> cidx(nq);
+  for (int q=0; q<nq; ++q) {
+    std::vector<numeric> cn(nodes[q].begin(), nodes[q].begin()+cdim);
+    cidx[q] = cquad.addNode(cn, 0);
+  }
+  int nqc = cquad.get_numnodes();
+
+  // conf basis at conf nodes, velocity coordinates of nodes and
+  // projection matrix with folded weights
+  std::vector<std::vector<ex> > cbasis_at_ord(nqc, std::vector<ex>(nc));
+  for (int q=0; q<nqc; ++q) {
+    exmap m;
+    for (int d=0; d<cdim; ++d) m[cbasis.get_var(d)] = cquad.get_nodes()[q][d];
+    for (int k=0; k<nc; ++k) cbasis_at_ord[q][k] = cbc[k].subs(m);
+  }
+  std::vector<std::vector<ex> > ordv(nq, std::vector<ex>(vdim));
+  std::vector<std::vector<ex> > proj(np, std::vector<ex>(nq));
+  for (int q=0; q<nq; ++q) {
+    exmap m;
+    for (int d=0; d<pdim; ++d) m[pbasis.get_var(d)] = nodes[q][d];
+    for (int j=0; j<vdim; ++j) ordv[q][j] = nodes[q][cdim+j];
+    for (int k=0; k<np; ++k) proj[k][q] = quad.get_weights()[q]*bc[k].subs(m);
+  }
+
+  // function definition
+  fc << "GKYL_CU_DH" << std::endl;
+  fc << "void" << std::endl;
+  fc << kn << args << std::endl;
+  fc << "{" << std::endl;
+
+  Gkyl::writeTable(fc, "  ", "cbasis_at_ord", cbasis_at_ord);
+  Gkyl::writeTable(fc, "  ", "ordv", ordv);
+  Gkyl::writeTable(fc, "  ", "proj", proj);
+  fc << "  static const int cidx[" << nq << "] = { ";
+  for (int q=0; q<nq; ++q) fc << cidx[q] << (q<nq-1 ? ", " : "");
+  fc << " };" << std::endl;
+  fc << std::endl;
+
+  // moments at conf nodes
+  fc << "  double den_q[" << nqc << "], u_q[" << nqc << "][" << vdim << "], vtsq_q[" << nqc << "];" << std::endl;
+  fc << "  for (int q=0; q<" << nqc << "; ++q) {" << std::endl;
+  fc << "    den_q[q] = 0.0; vtsq_q[q] = 0.0;" << std::endl;
+  fc << "    for (int j=0; j<" << vdim << "; ++j) u_q[q][j] = 0.0;" << std::endl;
+  fc << "    for (int k=0; k<" << nc << "; ++k) {" << std::endl;
+  fc << "      den_q[q] += cbasis_at_ord[q][k]*den[k];" << std::endl;
+  fc << "      vtsq_q[q] += cbasis_at_ord[q][k]*vtsq[k];" << std::endl;
+  fc << "      for (int j=0; j<" << vdim << "; ++j) u_q[q][j] += cbasis_at_ord[q][k]*udrift[j*" << nc << "+k];" << std::endl;
+  fc << "    }" << std::endl;
+  fc << "  }" << std::endl;
+  fc << std::endl;
+
+  // Maxwellian at the nodes
+  fc << "  double fq[" << nq << "];" << std::endl;
+  fc << "  for (int q=0; q<" << nq << "; ++q) {" << std::endl;
+  fc << "    int qc = cidx[q];" << std::endl;
+  fc << "    fq[q] = 0.0;" << std::endl;
+  fc << "    if (vtsq_q[qc] > 0.0) {" << std::endl;
+  fc << "      double vsq = 0.0;" << std::endl;
+  fc << "      for (int j=0; j<" << vdim << "; ++j) {" << std::endl;
+  fc << "        double v = w[" << cdim << "+j] + 0.5*dxv[" << cdim << "+j]*ordv[q][j] - u_q[qc][j];" << std::endl;
+  fc << "        vsq += v*v;" << std::endl;
+  fc << "      }" << std::endl;
+  fc << "      fq[q] = den_q[qc]/pow(" << csrc << (2*Pi).evalf() << "*vtsq_q[qc], " << vdim << "/2.0)*exp(-vsq/(2.0*vtsq_q[qc]));" << std::endl;
+  fc << "    }" << std::endl;
+  fc << "  }" << std::endl;
+  fc << std::endl;
+
+  // project on basis
+  fc << "  for (int k=0; k<" << np << "; ++k) {" << std::endl;
+  fc << "    f[k] = 0.0;" << std::endl;
+  fc << "    for (int q=0; q<" << nq << "; ++q) f[k] += proj[k][q]*fq[q];" << std::endl;
+  fc << "  }" << std::endl;
+
+  // close function
+  fc << "}" << std::endl << std::endl;
+
+  struct gkyl_kern_op_count count = {
+    (size_t) (nqc*nc*(2+vdim) + nq*(3*vdim+3) + np*nq),
+    (size_t) (nqc*nc*(2+vdim) + nq*(3*vdim+6) + np*nq)
+  };
+  Gkyl::writeOpCount(fh, fc, kn, count);
+}
+
+void
+gen_all_maxwellian_on_basis()
+{
+  // compute time-stamp
+  char buff[70];
+  time_t t = time(NULL);
+  struct tm curr_tm = *localtime(&t);
+  strftime(buff, sizeof buff, "%c", &curr_tm);
+
+  symbol z0("z0"), z1("z1"), z2("z2"), z3("z3"), z4("z4"), z5("z5");
+  std::vector<symbol> vars { z0, z1, z2, z3, z4, z5 };
+
+  // nodes and weights are computed well beyond double precision
+  Digits = 32;
+
+  std::ofstream mx_file_h("kernels/maxwellian_on_basis/gkyl_maxwellian_on_basis_kernels.h", std::ofstream::out);
+  mx_file_h << "// " << buff << std::endl;
+  mx_file_h << "#pragma once" << std::endl;
+  mx_file_h << "#include <gkyl_util.h>" << std::endl;
+  mx_file_h << "EXTERN_C_BEG" << std::endl;
+
+  struct timespec tstart = gkyl_wall_clock();
+
+  for (int cdim=1; cdim<=3; ++cdim) {
+    for (int vdim=cdim; vdim<=3; ++vdim) {
+      for (int p=1; p<=2; ++p) {
+        int pdim = cdim+vdim;
+        std::cout << cdim << "x" << vdim << "v" << "p" << p << " " << std::flush;
+        Gkyl::ModalBasis cbasis(Gkyl::MODAL_SER, cdim, 0, vars, p);
+        Gkyl::ModalBasis pbasis(Gkyl::MODAL_SER, pdim, 0, vars, p);
+
+        // each function is written to its own file to allow building
+        // kernels in parallel
+        std::ostringstream kn;
+        kn << "maxwellian_on_basis_" << cdim << "x" << vdim << "v_ser_" << "p" << p;
+        std::ofstream mx_file_c(("kernels/maxwellian_on_basis/" + kn.str() + ".c").c_str(), std::ofstream::out);
+        mx_file_c << "// " << buff << std::endl;
+        mx_file_c << "#include <math.h>" << std::endl;
+        mx_file_c << "#include <gkyl_maxwellian_on_basis_kernels.h>" << std::endl;
+        gen_maxwellian_on_basis(mx_file_h, mx_file_c, kn.str(), cbasis, pbasis, Gkyl::tensorQuad(Gkyl::QUAD_GAUSS_LEGENDRE, pdim, p+1));
+      }
+    }
+  }
+  std::cout << std::endl;
+
+  mx_file_h << "EXTERN_C_END" << std::endl;
+
+  double tm = gkyl_time_diff_now_sec(tstart);
+  std::cout << "Took " << tm << " seconds" << std::endl;
+}
+
+int
+main(int argc, char **argv)
+{
+  gen_all_maxwellian_on_basis();
+
+  return 1;
+}
@@ -0,0 +1,283 @@
+#include <modal_basis.h>
+#include <kernel_util.h>
+#include <cassert>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <gkyl_util.h>
+
+using namespace GiNaC;
+
+static const char *dir_names[] = { "x", "y", "z" };
+
+// Offsets s_d = -1 or +1 of fine cell c (of 2^ndim) in the coarse
+// cell, with the first direction varying slowest. The coarse
+// coordinate is z_c = (z_f+s)/2
+static std::vector<int>
+child_offsets(int ndim, int c)
+{
+  std::vector<int> s(ndim);
+  for (int d=ndim-1; d>=0; --d) {
+    s[d] = c%2 == 0 ? -1 : 1;
+    c /= 2;
+  }
+  return s;
+}
+
+// Matrix P_jk = < b_j(z_f), b_k((z_f+s)/2) > mapping coarse
+// coefficients to those of fine cell c
+static matrix
+calc_prolong(const Gkyl::ModalBasis& basis, int c)
+{
+  int ndim = basis.get_ndim(), nb = basis.get_numbasis();
+  std::vector<int> s = child_offsets(ndim, c);
+  exmap m;
+  for (int d=0; d<ndim; ++d)
+    m[basis.get_var(d)] = (basis.get_var(d)+s[d])/2;
+  lst bc = basis.get_basis();
+  matrix P(nb, nb);
+  for (int k=0; k<nb; ++k) {
+    lst pk = basis.project(bc[k].subs(m));
+    for (int j=0; j<nb; ++j)
+      P(j,k) = pk[j];
+  }
+  return P;
+}
+
+// Generates intergrid transfer kernels between a coarse cell and its
+// 2^ndim fine cells. Prolongation is the injection of the coarse
+// expansion into each fine cell and restriction is the L2 projection
+// of the fine expansions onto the coarse cell, i.e. 2^-ndim times the
+// transpose of prolongation. Generated function signatures:
+//
+// void foo_prolong(const double *fldC, double **fldF)
+// void foo_restrict(const double *const *fldF, double *fldC)
+//
+// fldF: pointers to the fine cells, with the first direction varying
+// slowest and the lower cell first in each direction.
+//
+// fh: header file
+// fc: C file
+//
+static void
+gen_intergrid(std::ostream& fh, std::ostream& fc, const std::string& kn, const Gkyl::ModalBasis& basis)
+{
+  int ndim = basis.get_ndim(), nb = basis.get_numbasis(), nchild = 1 << ndim;
+
+  fh << std::endl;
+  fh << "GKYL_CU_DH void " << kn << "_prolong(const double *fldC, double **fldF);" << std::endl;
+  fh << "GKYL_CU_DH void " << kn << "_restrict(const double *const *fldF, double *fldC);" << std::endl;
+
+  std::vector<matrix> P;
+  for (int c=0; c<nchild; ++c)
+    P.push_back(calc_prolong(basis, c));
+
+  symbol fldC("fldC");
+  fc << "GKYL_CU_DH" << std::endl;
+  fc << "void" << std::endl;
+  fc << kn << "_prolong(const double *fldC, double **fldF)" << std::endl;
+  fc << "{" << std::endl;
+  for (int c=0; c<nchild; ++c) {
+    fc << "  double *fld" << c << " = fldF[" << c << "];" << std::endl;
+    for (int j=0; j<nb; ++j) {
+      ex fj = 0;
+      for (int k=0; k<nb; ++k)
+        fj += P[c](j,k)*indexed(fldC, idx(k,1));
+      fc << "  fld" << c << "[" << j << "] = " << csrc << fj.evalf() << ";" << std::endl;
+    }
+  }
+  fc << "}" << std::endl << std::endl;
+
+  fc << "GKYL_CU_DH" << std::endl;
+  fc << "void" << std::endl;
+  fc << kn << "_restrict(const double *const *fldF, double *fldC)" << std::endl;
+  fc << "{" << std::endl;
+  std::vector<symbol> fs;
+  for (int c=0; c<nchild; ++c) {
+    std::ostringstream fn;
+    fn << "fld" << c;
+    fs.push_back(symbol(fn.str()));
+    fc << "  const double *fld" << c << " = fldF[" << c << "];" << std::endl;
+  }
+  for (int k=0; k<nb; ++k) {
+    ex fk = 0;
+    for (int c=0; c<nchild; ++c)
+      for (int j=0; j<nb; ++j)
+        fk += P[c](j,k)*indexed(fs[c], idx(j,1));
+    fc << "  fldC[" << k << "] = " << csrc << (fk/nchild).expand().evalf() << ";" << std::endl;
+  }
+  fc << "}" << std::endl << std::endl;
+}
+
+// Generates kernel computing, in one pass over a cell, the residual
+// res = rho - A.phi of the DG discretization A of -Laplacian(phi) =
+// rho and the damped Jacobi update phiOut = phi + omega*res/diag(A)
+// from the old phi. The face values and derivatives needed by the
+// twice integrated by parts Laplacian are taken from the recovery
+// polynomial across each face, as in the order-2 constant
+// coefficient diffusion kernels. Generated function signature:
+//
+// void foo(double omega, const double *dx, const double *rho, const double *const *phi,
+//   double *res, double *phiOut)
+//
+// phi: stencil pointers, phi[0] the cell, phi[1+2d] and phi[2+2d] the
+//   lower and upper neighbors in direction d.
+//
+// fh: header file
+// fc: C file
+//
+static void
+gen_jacobi(std::ostream& fh, std::ostream& fc, const std::string& kn, const Gkyl::ModalBasis& basis)
+{
+  int ndim = basis.get_ndim(), nb = basis.get_numbasis();
+  lst bc = basis.get_basis();
+  std::string args = "(double omega, const double *dx, const double *rho, const double *const *phi, "
+    "double *GKYL_RESTRICT res, double *GKYL_RESTRICT phiOut)";
+
+  fh << "GKYL_CU_DH void " << kn << args << ";" << std::endl;
+
+  fc << "GKYL_CU_DH" << std::endl;
+  fc << "void" << std::endl;
+  fc << kn << args << std::endl;
+  fc << "{" << std::endl;
+
+  symbol phiC("phiC");
+  std::vector<symbol> phiL, phiR, rdxSq;
+  lst over;
+  for (int k=0; k<nb; ++k) over.append( indexed(phiC, idx(k,1)) );
+  fc << "  const double *phiC = phi[0];" << std::endl;
+  for (int d=0; d<ndim; ++d) {
+    phiL.push_back(symbol(std::string("phiL") + dir_names[d]));
+    phiR.push_back(symbol(std::string("phiR") + dir_names[d]));
+    rdxSq.push_back(symbol(std::string("rdxSq") + dir_names[d]));
+    fc << "  const double *phiL" << dir_names[d] << " = phi[" << 1+2*d << "], *phiR" << dir_names[d]
+       << " = phi[" << 2+2*d << "];" << std::endl;
+    fc << "  const double rdxSq" << dir_names[d] << " = 4.0/(dx[" << d << "]*dx[" << d << "]);" << std::endl;
+    for (int k=0; k<nb; ++k) {
+      over.append( indexed(phiL[d], idx(k,1)) );
+      over.append( indexed(phiR[d], idx(k,1)) );
+    }
+  }
+
+  // A.phi = -sum_d (2/dx_d)^2 ( [b g' - b' g]_{-1}^{+1} + < b'', phi > )
+  // where g is the recovered phi on each face
+  std::vector<ex> Aphi(nb, 0);
+  for (int d=0; d<ndim; ++d) {
+    const symbol& z = basis.get_var(d);
+    ex gl = Gkyl::recoverFace(basis, d, basis.expand(phiL[d]), basis.expand(phiC));
+    ex gr = Gkyl::recoverFace(basis, d, basis.expand(phiC), basis.expand(phiR[d]));
+    exmap m0; m0[z] = 0;
+    ex gl0 = gl.subs(m0), dgl0 = GiNaC::diff(gl, z).subs(m0);
+    ex gr0 = gr.subs(m0), dgr0 = GiNaC::diff(gr, z).subs(m0);
+
+    // boundary terms on the faces, integrated over the face when ndim>1
+    exmap ml; ml[z] = -1;
+    exmap mr; mr[z] = 1;
+    std::vector<ex> bnd(nb);
+    for (int l=0; l<nb; ++l) {
+      ex b = bc[l], db = GiNaC::diff(bc[l], z);
+      bnd[l] = b.subs(mr)*dgr0 - db.subs(mr)*gr0 - b.subs(ml)*dgl0 + db.subs(ml)*gl0;
+    }
+    if (ndim > 1) {
+      Gkyl::ModalBasis sbasis(basis.surfBasis(d));
+      for (int l=0; l<nb; ++l)
+        bnd[l] = sbasis.innerProd(bnd[l], 1);
+    }
+    for (int l=0; l<nb; ++l) {
+      ex vol = basis.innerProd(GiNaC::diff(bc[l], z, 2), basis.expand(phiC));
+      Aphi[l] -= rdxSq[d]*(bnd[l]+vol).expand();
+    }
+  }
+
+  struct gkyl_kern_op_count count = { 0 };
+  lst aexprs;
+  for (int l=0; l<nb; ++l) aexprs.append(Aphi[l].expand());
+  symbol tmp("tmp");
+  Gkyl::CSEResult cres = Gkyl::cse(aexprs, over, tmp);
+  if (cres.temps.nops() > 0) {
+    fc << "  double tmp[" << cres.temps.nops() << "];" << std::endl;
+    count = Gkyl::addOps(count, Gkyl::writeAssign(fc, "  ", "tmp", cres.temps));
+  }
+  fc << std::endl;
+
+  for (int l=0; l<nb; ++l) {
+    ex al = cres.exprs[l].evalf();
+    fc << "  res[" << l << "] = rho[" << l << "]-(" << csrc << al << ");" << std::endl;
+    count = Gkyl::addOps(count, Gkyl::countOps(al));
+    count.num_sum += 1;
+  }
+  fc << std::endl;
+
+  // diagonal of A: coefficient of phiC[l] in (A.phi)_l
+  for (int l=0; l<nb; ++l) {
+    ex dl = Aphi[l].expand().coeff(indexed(phiC, idx(l,1)), 1);
+    exmap one;
+    for (int d=0; d<ndim; ++d) one[rdxSq[d]] = 1;
+    assert(!dl.subs(one).is_zero());
+    dl = dl.evalf();
+    fc << "  phiOut[" << l << "] = phiC[" << l << "]+omega*res[" << l << "]/(" << csrc << dl << ");" << std::endl;
+    count = Gkyl::addOps(count, Gkyl::countOps(dl));
+    count.num_sum += 2;
+    count.num_prod += 2;
+  }
+
+  fc << "}" << std::endl << std::endl;
+
+  Gkyl::writeOpCount(fh, fc, kn, count);
+}
+
+void
+gen_all_mg_poisson()
+{
+  // compute time-stamp
+  char buff[70];
+  time_t t = time(NULL);
+  struct tm curr_tm = *localtime(&t);
+  strftime(buff, sizeof buff, "%c", &curr_tm);
+
+  symbol z0("z0"), z1("z1"), z2("z2"), z3("z3"), z4("z4"), z5("z5");
+  std::vector<symbol> vars { z0, z1, z2, z3, z4, z5 };
+
+  std::ofstream mg_file_h("kernels/mg_poisson/gkyl_mg_poisson_kernels.h", std::ofstream::out);
+  mg_file_h << "// " << buff << std::endl;
+  mg_file_h << "#pragma once" << std::endl;
+  mg_file_h << "#include <gkyl_util.h>" << std::endl;
+  mg_file_h << "EXTERN_C_BEG" << std::endl;
+
+  struct timespec tstart = gkyl_wall_clock();
+
+  for (int dim=1; dim<=3; ++dim) {
+    for (int p=1; p<=2; ++p) {
+      std::cout << dim << "dp" << p << " " << std::flush;
+      Gkyl::ModalBasis basis(Gkyl::MODAL_SER, dim, 0, vars, p);
+
+      // each function is written to its own file to allow building
+      // kernels in parallel
+      std::ostringstream kn;
+      kn << "mg_poisson_dg_" << dim << "d_ser_p" << p;
+      std::ofstream inter_file_c(("kernels/mg_poisson/" + kn.str() + "_intergrid.c").c_str(), std::ofstream::out);
+      inter_file_c << "// " << buff << std::endl;
+      inter_file_c << "#include <gkyl_mg_poisson_kernels.h>" << std::endl;
+      gen_intergrid(mg_file_h, inter_file_c, kn.str(), basis);
+
+      std::ofstream jac_file_c(("kernels/mg_poisson/" + kn.str() + "_jacobi.c").c_str(), std::ofstream::out);
+      jac_file_c << "// " << buff << std::endl;
+      jac_file_c << "#include <gkyl_mg_poisson_kernels.h>" << std::endl;
+      gen_jacobi(mg_file_h, jac_file_c, kn.str() + "_jacobi", basis);
+    }
+  }
+  std::cout << std::endl;
+
+  mg_file_h << "EXTERN_C_END" << std::endl;
+
+  double tm = gkyl_time_diff_now_sec(tstart);
+  std::cout << "Took " << tm << " seconds" << std::endl;
+}
+
+int
+main(int argc, char **argv)
+{
+  gen_all_mg_poisson();
+
+  return 1;
+}
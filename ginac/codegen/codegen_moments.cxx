@@ -0,0 +1,484 @@
+#include <modal_basis.h>
+#include <kernel_util.h>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <gkyl_util.h>
+
+using namespace GiNaC;
+
+// Integral of e over the velocity coordinates of pbasis (logical
+// coordinates, no Jacobian)
+static ex
+integrate_vel(const Gkyl::ModalBasis& pbasis, int cdim, const ex& e)
+{
+  ex out = e;
+  for (int d=cdim; d<pbasis.get_ndim(); ++d)
+    out = Gkyl::integrate1d(out, pbasis.get_var(d));
+  return out.expand();
+}
+
+// Physical velocity coordinate v_j = w+dxv/2*z in cell
+static ex
+vel_coord(const Gkyl::ModalBasis& pbasis, int cdim, int j)
+{
+  symbol w("w"), dxv("dxv");
+  return indexed(w, idx(cdim+j,1)) + indexed(dxv, idx(cdim+j,1))/2*pbasis.get_var(cdim+j);
+}
+
+// Velocity weights of the Vlasov moments M0, M1i, M2, M3i, in the
+// order they are stored in the output array
+static std::vector<ex>
+vlasov_mom_weights(const Gkyl::ModalBasis& pbasis, int cdim)
+{
+  int vdim = pbasis.get_ndim()-cdim;
+  ex vsq = 0;
+  for (int j=0; j<vdim; ++j)
+    vsq += pow(vel_coord(pbasis, cdim, j), 2);
+
+  std::vector<ex> wts;
+  wts.push_back(1);
+  for (int j=0; j<vdim; ++j) wts.push_back(vel_coord(pbasis, cdim, j));
+  wts.push_back(vsq);
+  for (int j=0; j<vdim; ++j) wts.push_back(vsq*vel_coord(pbasis, cdim, j));
+  return wts;
+}
+
+// Velocity weights of the gyrokinetic moments M0, M1, M2, M3par and,
+// when the magnetic moment is a coordinate, M3perp, including the
+// velocity-space Jacobian 2*pi*B/m in that case. M2 is the total
+// (vpar^2 + 2*mu*B/m) moment, M3par the vpar^3 moment and M3perp the
+// vpar*mu*B/m moment
+static std::vector<ex>
+gk_mom_weights(const Gkyl::ModalBasis& cbasis, const Gkyl::ModalBasis& pbasis)
+{
+  int cdim = cbasis.get_ndim(), vdim = pbasis.get_ndim()-cdim;
+  symbol m_("m_"), bmag("bmag");
+  lst cbc = cbasis.get_basis();
+  ex B = 0;
+  for (int k=0; k<cbasis.get_numbasis(); ++k)
+    B += cbc[k]*indexed(bmag, idx(k,1));
+
+  ex vpar = vel_coord(pbasis, cdim, 0), jac = 1, muBm = 0;
+  if (vdim > 1) {
+    jac = 2*Pi*B/m_;
+    muBm = vel_coord(pbasis, cdim, 1)*B/m_;
+  }
+
+  std::vector<ex> wts;
+  wts.push_back(jac);
+  wts.push_back(jac*vpar);
+  wts.push_back(jac*(vpar*vpar + 2*muBm));
+  wts.push_back(jac*pow(vpar,3));
+  if (vdim > 1)
+    wts.push_back(jac*vpar*muBm);
+  return wts;
+}
+
+// Volume factor prod_j dxv[cdim+j]/2 of the velocity cell
+static ex
+vel_volume(int cdim, int vdim)
+{
+  symbol dxv("dxv");
+  ex vol = 1;
+  for (int j=0; j<vdim; ++j)
+    vol *= indexed(dxv, idx(cdim+j,1))/2;
+  return vol;
+}
+
+// Generates kernel computing all velocity moments of f in a single
+// pass over the phase-space cell and accumulating them into
+// configuration-space output. The velocity cell-center, width and
+// volume scaling are folded into the coefficients and repeated
+// coefficient combinations are shared between moments. Generated
+// function signatures:
+//
+// void foo(const double *w, const double *dxv, const double *f, double *out)
+// void foo(const double *w, const double *dxv, double m_, const double *bmag, const double *f, double *out)
+//
+// The second form is used for gyrokinetics.
+//
+// out: moments, each a conf-space expansion. For Vlasov these are
+//   M0, M1i (vdim components), M2, M3i (vdim components). For
+//   gyrokinetics M0, M1, M2, M3par and, for vdim = 2, M3perp.
+//
+// fh: header file
+// fc: C file
+//
+static void
+gen_mom(std::ostream& fh, std::ostream& fc, const std::string& kn, bool is_gk,
+  const Gkyl::ModalBasis& cbasis, const Gkyl::ModalBasis& pbasis)
+{
+  int cdim = cbasis.get_ndim(), pdim = pbasis.get_ndim(), vdim = pdim-cdim;
+  int nc = cbasis.get_numbasis(), np = pbasis.get_numbasis();
+  std::string args = is_gk ?
+    "(const double *w, const double *dxv, double m_, const double *bmag, const double *f, double *GKYL_RESTRICT out )" :
+    "(const double *w, const double *dxv, const double *f, double *GKYL_RESTRICT out )";
+
+  // function declaration
+  fh << std::endl << "GKYL_CU_DH void " << kn << args << ";" << std::endl;
+
+  // function definition
+  fc << "GKYL_CU_DH" << std::endl;
+  fc << "void" << std::endl;
+  fc << kn << args << std::endl;
+  fc << "{" << std::endl;
+
+  symbol f("f");
+  lst fsym;
+  for (int m=0; m<np; ++m)
+    fsym.append( indexed(f, idx(m,1)) );
+  ex fexp = pbasis.expand(f);
+  ex vol = vel_volume(cdim, vdim);
+
+  std::vector<ex> wts = is_gk ? gk_mom_weights(cbasis, pbasis) : vlasov_mom_weights(pbasis, cdim);
+  lst outs;
+  for (size_t n=0; n<wts.size(); ++n) {
+    std::cout << "M" << n << " " << std::flush;
+    lst mom = cbasis.project(vol*integrate_vel(pbasis, cdim, wts[n]*fexp));
+    for (int k=0; k<nc; ++k)
+      outs.append(mom[k].expand());
+  }
+  std::cout << std::endl;
+
+  struct gkyl_kern_op_count count = Gkyl::writeIncrCSE(fc, outs, fsym);
+
+  // close function
+  fc << "}" << std::endl << std::endl;
+
+  Gkyl::writeOpCount(fh, fc, kn, count);
+}
+
+// Writes header and source file for kernel kn and calls gen_mom
+static void
+gen_mom_file(std::ostream& fh, const char *buff, const std::string& hn, const std::string& kn,
+  bool is_gk, const Gkyl::ModalBasis& cbasis, const Gkyl::ModalBasis& pbasis)
+{
+  // each function is written to its own file to allow building
+  // kernels in parallel
+  std::ofstream mom_file_c(("kernels/moments/" + kn + ".c").c_str(), std::ofstream::out);
+  mom_file_c << "// " << buff << std::endl;
+  mom_file_c << "#include <" << hn << ">" << std::endl;
+  gen_mom(fh, mom_file_c, kn, is_gk, cbasis, pbasis);
+}
+
+void
+gen_all_mom()
+{
+  // compute time-stamp
+  char buff[70];
+  time_t t = time(NULL);
+  struct tm curr_tm = *localtime(&t);
+  strftime(buff, sizeof buff, "%c", &curr_tm);
+
+  symbol z0("z0"), z1("z1"), z2("z2"), z3("z3"), z4("z4"), z5("z5");
+  std::vector<symbol> vars { z0, z1, z2, z3, z4, z5 };
+
+  std::string hn = "gkyl_mom_kernels.h";
+  std::ofstream mom_file_h(("kernels/moments/" + hn).c_str(), std::ofstream::out);
+  mom_file_h << "// " << buff << std::endl;
+  mom_file_h << "#pragma once" << std::endl;
+  mom_file_h << "#include <gkyl_util.h>" << std::endl;
+  mom_file_h << "EXTERN_C_BEG" << std::endl;
+
+  struct timespec tstart = gkyl_wall_clock();
+
+  // Vlasov: serendipity and hybrid bases
+  for (int cdim=1; cdim<=3; ++cdim) {
+    for (int vdim=cdim; vdim<=3; ++vdim) {
+      for (int p=1; p<=2; ++p) {
+        std::cout << cdim << "x" << vdim << "v" << "p" << p << " " << std::flush;
+        Gkyl::ModalBasis cbasis(Gkyl::MODAL_SER, cdim, 0, vars, p);
+        Gkyl::ModalBasis pbasis(Gkyl::MODAL_SER, cdim+vdim, 0, vars, p);
+        std::ostringstream kn;
+        kn << "vlasov_mom_" << cdim << "x" << vdim << "v_ser_" << "p" << p;
+        gen_mom_file(mom_file_h, buff, hn, kn.str(), false, cbasis, pbasis);
+      }
+      int p = 1;
+      std::cout << cdim << "x" << vdim << "v" << "p" << p << " (hyb) " << std::flush;
+      Gkyl::ModalBasis cbasis(Gkyl::MODAL_SER, cdim, 0, vars, p);
+      Gkyl::ModalBasis pbasis(Gkyl::MODAL_HYB, cdim+vdim, vdim, vars, p);
+      std::ostringstream kn;
+      kn << "vlasov_mom_" << cdim << "x" << vdim << "v_hyb_" << "p" << p;
+      gen_mom_file(mom_file_h, buff, hn, kn.str(), false, cbasis, pbasis);
+    }
+  }
+
+  // gyrokinetics: gkhyb basis
+  for (int cdim=1; cdim<=3; ++cdim) {
+    for (int vdim=std::min(cdim,2); vdim<=2; ++vdim) {
+      int p = 1;
+      std::cout << cdim << "x" << vdim << "v" << "p" << p << " (gkhyb) " << std::flush;
+      Gkyl::ModalBasis cbasis(Gkyl::MODAL_SER, cdim, 0, vars, p);
+      Gkyl::ModalBasis pbasis(Gkyl::MODAL_GKHYB, cdim+vdim, vdim, vars, p);
+      std::ostringstream kn;
+      kn << "gyrokinetic_mom_" << cdim << "x" << vdim << "v_gkhyb_" << "p" << p;
+      gen_mom_file(mom_file_h, buff, hn, kn.str(), true, cbasis, pbasis);
+    }
+  }
+
+  mom_file_h << "EXTERN_C_END" << std::endl;
+
+  double tm = gkyl_time_diff_now_sec(tstart);
+  std::cout << "Took " << tm << " seconds" << std::endl;
+}
+
+// Generates kernel computing moments integrated over the phase-space
+// cell. Since the basis is orthonormal and the velocity weights are
+// low-order polynomials, only the few coefficients of f that are not
+// orthogonal to the weights contribute. Also generates a batched
+// variant that reduces over ncells cells into a local accumulator
+// before adding to out. Generated function signatures:
+//
+// void foo(const double *w, const double *dxv, [double m_, const double *bmag,] const double *f, double *out)
+// void foo_batch(int ncells, const double *w, const double *dxv, [double m_, const double *bmag,] const double *f, double *out)
+//
+// The bracketed arguments are used for gyrokinetics. In the batched
+// variant w, f (and bmag) hold ncells consecutive cells, while dxv
+// is shared.
+//
+// out: integrated moments. For Vlasov these are M0, M1i (vdim
+//   components) and M2, for gyrokinetics M0, M1 and M2.
+//
+// fh: header file
+// fc: C file
+//
+static void
+gen_int_mom(std::ostream& fh, std::ostream& fc, const std::string& kn, bool is_gk,
+  const Gkyl::ModalBasis& cbasis, const Gkyl::ModalBasis& pbasis)
+{
+  int cdim = cbasis.get_ndim(), pdim = pbasis.get_ndim(), vdim = pdim-cdim;
+  int nc = cbasis.get_numbasis(), np = pbasis.get_numbasis();
+  std::string gk_args = is_gk ? " double m_, const double *bmag," : "";
+  std::string args = "(const double *w, const double *dxv," + gk_args
+    + " const double *f, double *GKYL_RESTRICT out )";
+  std::string batch_args = "(int ncells, const double *w, const double *dxv," + gk_args
+    + " const double *f, double *GKYL_RESTRICT out )";
+
+  // function declarations
+  fh << std::endl << "GKYL_CU_DH void " << kn << args << ";" << std::endl;
+  fh << "GKYL_CU_DH void " << kn << "_batch" << batch_args << ";" << std::endl;
+
+  // function definition
+  fc << "GKYL_CU_DH" << std::endl;
+  fc << "void" << std::endl;
+  fc << kn << args << std::endl;
+  fc << "{" << std::endl;
+
+  symbol f("f"), dxv("dxv");
+  lst fsym;
+  for (int m=0; m<np; ++m)
+    fsym.append( indexed(f, idx(m,1)) );
+  ex fexp = pbasis.expand(f);
+
+  // volume of the phase-space cell
+  ex vol = 1;
+  for (int d=0; d<pdim; ++d)
+    vol *= indexed(dxv, idx(d,1))/2;
+
+  // the moments are M0, M1 and M2 (the first 2+vdim Vlasov weights)
+  std::vector<ex> wts = is_gk ? gk_mom_weights(cbasis, pbasis) : vlasov_mom_weights(pbasis, cdim);
+  int nmom = is_gk ? 3 : 2+vdim;
+  lst outs;
+  for (int n=0; n<nmom; ++n)
+    outs.append( (vol*pbasis.innerProd(1, wts[n]*fexp)).expand() );
+
+  struct gkyl_kern_op_count count = Gkyl::writeIncrCSE(fc, outs, fsym);
+
+  // close function
+  fc << "}" << std::endl << std::endl;
+
+  Gkyl::writeOpCount(fh, fc, kn, count);
+  fc << std::endl;
+
+  // batched reduction
+  fc << "GKYL_CU_DH" << std::endl;
+  fc << "void" << std::endl;
+  fc << kn << "_batch" << batch_args << std::endl;
+  fc << "{" << std::endl;
+  fc << "  double red[" << nmom << "] = { 0.0 };" << std::endl;
+  fc << "  for (int i=0; i<ncells; ++i)" << std::endl;
+  fc << "    " << kn << "(w+i*" << pdim << ", dxv," << (is_gk ? " m_, bmag+i*" : "");
+  if (is_gk) fc << nc << ",";
+  fc << " f+i*" << np << ", red);" << std::endl;
+  fc << "  for (int n=0; n<" << nmom << "; ++n)" << std::endl;
+  fc << "    out[n] += red[n];" << std::endl;
+  fc << "}" << std::endl << std::endl;
+}
+
+// Generates kernel computing the integral of f^2 over the cell. As the
+// basis is orthonormal this is the cell volume times the sum of
+// squares of the coefficients. The batched variant sums the squares
+// over ncells consecutive cells and applies the volume factor
+// once. Generated function signatures:
+//
+// void foo(const double *dxv, const double *f, double *out)
+// void foo_batch(int ncells, const double *dxv, const double *fin, double *out)
+//
+// out: integral is accumulated into out[0]
+//
+// fh: header file
+// fc: C file
+//
+static void
+gen_l2norm(std::ostream& fh, std::ostream& fc, const std::string& kn, int ndim, int np)
+{
+  std::string args = "(const double *dxv, const double *f, double *GKYL_RESTRICT out )";
+  std::string batch_args = "(int ncells, const double *dxv, const double *fin, double *GKYL_RESTRICT out )";
+
+  // function declarations
+  fh << std::endl << "GKYL_CU_DH void " << kn << args << ";" << std::endl;
+  fh << "GKYL_CU_DH void " << kn << "_batch" << batch_args << ";" << std::endl;
+
+  std::ostringstream vol, sumsq;
+  for (int d=0; d<ndim; ++d)
+    vol << (d>0 ? "*" : "") << "(0.5*dxv[" << d << "])";
+  for (int m=0; m<np; ++m)
+    sumsq << (m>0 ? " + " : "") << "f[" << m << "]*f[" << m << "]";
+
+  // function definition
+  fc << "GKYL_CU_DH" << std::endl;
+  fc << "void" << std::endl;
+  fc << kn << args << std::endl;
+  fc << "{" << std::endl;
+  fc << "  out[0] += " << vol.str() << "*(" << sumsq.str() << ");" << std::endl;
+  fc << "}" << std::endl << std::endl;
+
+  struct gkyl_kern_op_count count = { (size_t) np, (size_t) (np+ndim*2) };
+  Gkyl::writeOpCount(fh, fc, kn, count);
+  fc << std::endl;
+
+  // batched reduction
+  fc << "GKYL_CU_DH" << std::endl;
+  fc << "void" << std::endl;
+  fc << kn << "_batch" << batch_args << std::endl;
+  fc << "{" << std::endl;
+  fc << "  double sum = 0.0;" << std::endl;
+  fc << "  for (int i=0; i<ncells; ++i) {" << std::endl;
+  fc << "    const double *f = fin+i*" << np << ";" << std::endl;
+  fc << "    sum += " << sumsq.str() << ";" << std::endl;
+  fc << "  }" << std::endl;
+  fc << "  out[0] += " << vol.str() << "*sum;" << std::endl;
+  fc << "}" << std::endl << std::endl;
+}
+
+// Writes source file for l2norm kernel of basis
+static void
+gen_l2norm_file(std::ostream& fh, const char *buff, const std::string& kn, const Gkyl::ModalBasis& basis)
+{
+  // each function is written to its own file to allow building
+  // kernels in parallel
+  std::ofstream l2_file_c(("kernels/moments/" + kn + ".c").c_str(), std::ofstream::out);
+  l2_file_c << "// " << buff << std::endl;
+  l2_file_c << "#include <gkyl_int_mom_kernels.h>" << std::endl;
+  gen_l2norm(fh, l2_file_c, kn, basis.get_ndim(), basis.get_numbasis());
+}
+
+// Writes source file for integrated moment kernel kn
+static void
+gen_int_mom_file(std::ostream& fh, const char *buff, const std::string& kn,
+  bool is_gk, const Gkyl::ModalBasis& cbasis, const Gkyl::ModalBasis& pbasis)
+{
+  // each function is written to its own file to allow building
+  // kernels in parallel
+  std::ofstream int_file_c(("kernels/moments/" + kn + ".c").c_str(), std::ofstream::out);
+  int_file_c << "// " << buff << std::endl;
+  int_file_c << "#include <gkyl_int_mom_kernels.h>" << std::endl;
+  gen_int_mom(fh, int_file_c, kn, is_gk, cbasis, pbasis);
+}
+
+void
+gen_all_int_mom()
+{
+  // compute time-stamp
+  char buff[70];
+  time_t t = time(NULL);
+  struct tm curr_tm = *localtime(&t);
+  strftime(buff, sizeof buff, "%c", &curr_tm);
+
+  symbol z0("z0"), z1("z1"), z2("z2"), z3("z3"), z4("z4"), z5("z5");
+  std::vector<symbol> vars { z0, z1, z2, z3, z4, z5 };
+
+  std::ofstream int_file_h("kernels/moments/gkyl_int_mom_kernels.h", std::ofstream::out);
+  int_file_h << "// " << buff << std::endl;
+  int_file_h << "#pragma once" << std::endl;
+  int_file_h << "#include <gkyl_util.h>" << std::endl;
+  int_file_h << "EXTERN_C_BEG" << std::endl;
+
+  struct timespec tstart = gkyl_wall_clock();
+
+  // Vlasov: serendipity and hybrid bases
+  for (int cdim=1; cdim<=3; ++cdim) {
+    for (int vdim=cdim; vdim<=3; ++vdim) {
+      for (int p=1; p<=2; ++p) {
+        std::cout << cdim << "x" << vdim << "v" << "p" << p << " " << std::flush;
+        Gkyl::ModalBasis cbasis(Gkyl::MODAL_SER, cdim, 0, vars, p);
+        Gkyl::ModalBasis pbasis(Gkyl::MODAL_SER, cdim+vdim, 0, vars, p);
+        std::ostringstream kn;
+        kn << "vlasov_int_mom_" << cdim << "x" << vdim << "v_ser_" << "p" << p;
+        gen_int_mom_file(int_file_h, buff, kn.str(), false, cbasis, pbasis);
+      }
+      int p = 1;
+      std::cout << cdim << "x" << vdim << "v" << "p" << p << " (hyb) " << std::flush;
+      Gkyl::ModalBasis cbasis(Gkyl::MODAL_SER, cdim, 0, vars, p);
+      Gkyl::ModalBasis pbasis(Gkyl::MODAL_HYB, cdim+vdim, vdim, vars, p);
+      std::ostringstream kn;
+      kn << "vlasov_int_mom_" << cdim << "x" << vdim << "v_hyb_" << "p" << p;
+      gen_int_mom_file(int_file_h, buff, kn.str(), false, cbasis, pbasis);
+
+      std::ostringstream ln;
+      ln << "l2norm_" << cdim << "x" << vdim << "v_hyb_" << "p" << p;
+      gen_l2norm_file(int_file_h, buff, ln.str(), pbasis);
+    }
+  }
+
+  // gyrokinetics: gkhyb basis
+  for (int cdim=1; cdim<=3; ++cdim) {
+    for (int vdim=std::min(cdim,2); vdim<=2; ++vdim) {
+      int p = 1;
+      std::cout << cdim << "x" << vdim << "v" << "p" << p << " (gkhyb) " << std::flush;
+      Gkyl::ModalBasis cbasis(Gkyl::MODAL_SER, cdim, 0, vars, p);
+      Gkyl::ModalBasis pbasis(Gkyl::MODAL_GKHYB, cdim+vdim, vdim, vars, p);
+      std::ostringstream kn;
+      kn << "gyrokinetic_int_mom_" << cdim << "x" << vdim << "v_gkhyb_" << "p" << p;
+      gen_int_mom_file(int_file_h, buff, kn.str(), true, cbasis, pbasis);
+
+      std::ostringstream ln;
+      ln << "l2norm_" << cdim << "x" << vdim << "v_gkhyb_" << "p" << p;
+      gen_l2norm_file(int_file_h, buff, ln.str(), pbasis);
+    }
+  }
+
+  // l2 norm on serendipity and tensor bases
+  int max_order[] = { 3, 3, 3, 3, 3, 2 };
+  for (int dim=1; dim<=6; ++dim) {
+    for (int p=1; p<=max_order[dim-1]; ++p) {
+      Gkyl::ModalBasis basis(Gkyl::MODAL_SER, dim, 0, vars, p);
+      std::ostringstream ln;
+      ln << "l2norm_" << dim << "d_ser_" << "p" << p;
+      gen_l2norm_file(int_file_h, buff, ln.str(), basis);
+    }
+  }
+  for (int dim=2; dim<=5; ++dim) {
+    int p = 2;
+    Gkyl::ModalBasis basis(Gkyl::MODAL_TEN, dim, 0, vars, p);
+    std::ostringstream ln;
+    ln << "l2norm_" << dim << "d_tensor_" << "p" << p;
+    gen_l2norm_file(int_file_h, buff, ln.str(), basis);
+  }
+  std::cout << std::endl;
+
+  int_file_h << "EXTERN_C_END" << std::endl;
+
+  double tm = gkyl_time_diff_now_sec(tstart);
+  std::cout << "Took " << tm << " seconds" << std::endl;
+}
+
+int
+main(int argc, char **argv)
+{
+  gen_all_mom();
+  gen_all_int_mom();
+
+  return 1;
+}
@@ -0,0 +1,205 @@
+#include <modal_basis.h>
+#include <kernel_util.h>
+#include <quadrature.h>
+#include <algorithm>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <gkyl_util.h>
+
+using namespace GiNaC;
+
+// Gauss-Lobatto points with n = deg+1 points on [-1,1] (at least the
+// end points). The midpoint of odd rules is found by Newton iterations
+// and is snapped to zero so that it drops terms from the kernels
+static std::vector<ex>
+lobatto_points(int deg)
+{
+  std::vector<numeric> x, wt;
+  Gkyl::quad1d(Gkyl::QUAD_GAUSS_LOBATTO, std::max(deg, 1)+1, x, wt);
+  std::vector<ex> z;
+  for (size_t i=0; i<x.size(); ++i)
+    z.push_back(abs(x[i]) < numeric(1, 1000000000) ? ex(0) : ex(x[i]));
+  return z;
+}
+
+// Control nodes of basis: the tensor product of Gauss-Lobatto points,
+// with deg+1 points in each direction where deg is the highest degree
+// of the basis in that direction
+static std::vector<exmap>
+control_nodes(const Gkyl::ModalBasis& basis)
+{
+  int ndim = basis.get_ndim();
+  lst mo = basis.get_monomials();
+  std::vector<std::vector<ex> > pts(ndim);
+  for (int d=0; d<ndim; ++d) {
+    int deg = 0;
+    for (size_t m=0; m<mo.nops(); ++m)
+      deg = std::max(deg, mo[m].degree(basis.get_var(d)));
+    pts[d] = lobatto_points(deg);
+  }
+
+  std::vector<exmap> nodes(1);
+  for (int d=0; d<ndim; ++d) {
+    std::vector<exmap> next;
+    for (size_t n=0; n<nodes.size(); ++n)
+      for (size_t i=0; i<pts[d].size(); ++i) {
+        exmap m = nodes[n];
+        m[basis.get_var(d)] = pts[d][i];
+        next.push_back(m);
+      }
+    nodes = next;
+  }
+  return nodes;
+}
+
+// Generates kernel returning the minimum of the expansion over the
+// control nodes, and a kernel applying the Zhang-Shu limiter in place:
+// the expansion is scaled about its cell average by
+//
+//   theta = min(1, max(0, (favg-eps)/(favg-fmin)))
+//
+// so that its minimum over the control nodes is at least eps (if the
+// cell average is). Both are branch-free: the minimum is a chain of
+// fmin and theta is formed with fmin/fmax. Generated function
+// signatures:
+//
+// double positivity_min_foo(const double *f)
+// double positivity_rescale_foo(double eps, double *f)
+//
+// The rescale kernel returns theta.
+//
+// fh: header file
+// fc: C file
+//
+static void
+gen_positivity(std::ostream& fh, std::ostream& fc, const std::string& suf, const Gkyl::ModalBasis& basis)
+{
+  int nb = basis.get_numbasis();
+  lst bc = basis.get_basis();
+  std::string mn = "positivity_min_" + suf, rn = "positivity_rescale_" + suf;
+
+  fh << std::endl;
+  fh << "GKYL_CU_DH double " << mn << "(const double *f);" << std::endl;
+  fh << "GKYL_CU_DH double " << rn << "(double eps, double *f);" << std::endl;
+
+  symbol f("f");
+  ex fexp = basis.expand(f);
+  std::vector<exmap> nodes = control_nodes(basis);
+
+  struct gkyl_kern_op_count count = { 0 };
+  fc << "GKYL_CU_DH" << std::endl;
+  fc << "double" << std::endl;
+  fc << mn << "(const double *f)" << std::endl;
+  fc << "{" << std::endl;
+  for (size_t n=0; n<nodes.size(); ++n) {
+    ex fn = fexp.subs(nodes[n]).expand().evalf();
+    if (n == 0)
+      fc << "  double fmin_c = " << csrc << fn << ";" << std::endl;
+    else
+      fc << "  fmin_c = fmin(fmin_c, " << csrc << fn << ");" << std::endl;
+    count = Gkyl::addOps(count, Gkyl::countOps(fn));
+  }
+  fc << "  return fmin_c;" << std::endl;
+  fc << "}" << std::endl << std::endl;
+
+  Gkyl::writeOpCount(fh, fc, mn, count);
+  fc << std::endl;
+
+  // the cell average is f[0] times the (constant) first basis function
+  fc << "GKYL_CU_DH" << std::endl;
+  fc << "double" << std::endl;
+  fc << rn << "(double eps, double *f)" << std::endl;
+  fc << "{" << std::endl;
+  fc << "  const double favg = " << csrc << (bc[0]*indexed(f, idx(0,1))).evalf() << ";" << std::endl;
+  fc << "  const double fmin_c = " << mn << "(f);" << std::endl;
+  fc << "  const double theta = fmin(1.0, fmax(0.0, (favg-eps)/fmax(favg-fmin_c, 1.0e-300)));" << std::endl;
+  for (int k=1; k<nb; ++k)
+    fc << "  f[" << k << "] *= theta;" << std::endl;
+  fc << "  return theta;" << std::endl;
+  fc << "}" << std::endl << std::endl;
+}
+
+// Writes source file for the positivity kernels with suffix suf
+static void
+gen_positivity_file(std::ostream& fh, const char *buff, const std::string& suf,
+  const Gkyl::ModalBasis& basis)
+{
+  // each function is written to its own file to allow building
+  // kernels in parallel
+  std::ofstream pos_file_c(("kernels/positivity/positivity_" + suf + ".c").c_str(), std::ofstream::out);
+  pos_file_c << "// " << buff << std::endl;
+  pos_file_c << "#include <math.h>" << std::endl;
+  pos_file_c << "#include <gkyl_positivity_kernels.h>" << std::endl;
+  gen_positivity(fh, pos_file_c, suf, basis);
+}
+
+void
+gen_all_positivity()
+{
+  // compute time-stamp
+  char buff[70];
+  time_t t = time(NULL);
+  struct tm curr_tm = *localtime(&t);
+  strftime(buff, sizeof buff, "%c", &curr_tm);
+
+  symbol z0("z0"), z1("z1"), z2("z2"), z3("z3"), z4("z4"), z5("z5");
+  std::vector<symbol> vars { z0, z1, z2, z3, z4, z5 };
+
+  // nodes are computed well beyond double precision
+  Digits = 32;
+
+  std::ofstream pos_file_h("kernels/positivity/gkyl_positivity_kernels.h", std::ofstream::out);
+  pos_file_h << "// " << buff << std::endl;
+  pos_file_h << "#pragma once" << std::endl;
+  pos_file_h << "#include <gkyl_util.h>" << std::endl;
+  pos_file_h << "EXTERN_C_BEG" << std::endl;
+
+  struct timespec tstart = gkyl_wall_clock();
+
+  // serendipity: p2 only up to 5D, as 6D p2 has 729 control nodes
+  for (int dim=1; dim<=6; ++dim) {
+    for (int p=1; p<=(dim<6 ? 2 : 1); ++p) {
+      std::cout << dim << "dp" << p << " " << std::flush;
+      Gkyl::ModalBasis basis(Gkyl::MODAL_SER, dim, 0, vars, p);
+      std::ostringstream suf;
+      suf << dim << "d_ser_p" << p;
+      gen_positivity_file(pos_file_h, buff, suf.str(), basis);
+    }
+  }
+  std::cout << std::endl;
+
+  // Vlasov and gyrokinetic hybrid bases
+  for (int cdim=1; cdim<=3; ++cdim) {
+    for (int vdim=cdim; vdim<=3; ++vdim) {
+      std::cout << cdim << "x" << vdim << "v (hyb) " << std::flush;
+      Gkyl::ModalBasis basis(Gkyl::MODAL_HYB, cdim+vdim, vdim, vars, 1);
+      std::ostringstream suf;
+      suf << cdim << "x" << vdim << "v_hyb_p1";
+      gen_positivity_file(pos_file_h, buff, suf.str(), basis);
+    }
+  }
+  for (int cdim=1; cdim<=3; ++cdim) {
+    for (int vdim=std::min(cdim,2); vdim<=2; ++vdim) {
+      std::cout << cdim << "x" << vdim << "v (gkhyb) " << std::flush;
+      Gkyl::ModalBasis basis(Gkyl::MODAL_GKHYB, cdim+vdim, vdim, vars, 1);
+      std::ostringstream suf;
+      suf << cdim << "x" << vdim << "v_gkhyb_p1";
+      gen_positivity_file(pos_file_h, buff, suf.str(), basis);
+    }
+  }
+  std::cout << std::endl;
+
+  pos_file_h << "EXTERN_C_END" << std::endl;
+
+  double tm = gkyl_time_diff_now_sec(tstart);
+  std::cout << "Took " << tm << " seconds" << std::endl;
+}
+
+int
+main(int argc, char **argv)
+{
+  gen_all_positivity();
+
+  return 1;
+}
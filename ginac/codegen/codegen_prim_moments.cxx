@@ -0,0 +1,301 @@
+#include <modal_basis.h>
+#include <kernel_util.h>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <gkyl_util.h>
+
+using namespace GiNaC;
+
+// Writes the weak-multiplication matrix <b_k, g b_l> of the
+// expansion g into the nc x nc block of A starting at (r0, c0)
+static void
+set_weak_block(const Gkyl::ModalBasis& cbasis, matrix& A, int r0, int c0, const ex& g)
+{
+  int nc = cbasis.get_numbasis();
+  lst bc = cbasis.get_basis();
+  for (int k=0; k<nc; ++k)
+    for (int l=0; l<=k; ++l) {
+      ex akl = cbasis.innerProd(bc[k]*bc[l], g).expand();
+      A(r0+k,c0+l) = akl;
+      A(r0+l,c0+k) = akl;
+    }
+}
+
+// Generates kernel computing the self primitive moments, i.e. the
+// flow u (nu components) and thermal speed squared vtSq from the
+// moments M0, M1 and M2, including the boundary corrections cM and cE
+// of the LBO operator. The weak system
+//
+//   m0*u_i - cM_i*vtSq = m1_i
+//   sum_i m1_i*u_i + (vdim*m0 - cE)*vtSq = m2
+//
+// couples all nc*(nu+1) coefficients and is not symmetric. It is
+// assembled and solved in the kernel with an unrolled LU
+// factorization. Also generates a variant looping over ncells
+// consecutive conf cells. Generated function signatures:
+//
+// void foo(const double *moms, const double *boundary_corrections, double *prim_moms)
+// void foo_batch(int ncells, const double *moms, const double *boundary_corrections, double *prim_moms)
+//
+// moms: M0, M1 (nu components), M2
+// boundary_corrections: cM (nu components), cE
+// prim_moms: u (nu components), vtSq
+//
+// fh: header file
+// fc: C file
+// nu: number of flow components (vdim for Vlasov, 1 for gyrokinetics)
+// vdim: number of velocity degrees of freedom in M2
+//
+static void
+gen_self_prim(std::ostream& fh, std::ostream& fc, const std::string& kn,
+  const Gkyl::ModalBasis& cbasis, int nu, int vdim)
+{
+  int nc = cbasis.get_numbasis(), n = (nu+1)*nc;
+  std::string args =
+    "(const double *moms, const double *boundary_corrections, double *GKYL_RESTRICT prim_moms )";
+  std::string batch_args =
+    "(int ncells, const double *moms, const double *boundary_corrections, double *GKYL_RESTRICT prim_moms )";
+
+  // function declarations
+  fh << std::endl << "GKYL_CU_DH void " << kn << args << ";" << std::endl;
+  fh << "GKYL_CU_DH void " << kn << "_batch" << batch_args << ";" << std::endl;
+
+  // function definition
+  fc << "GKYL_CU_DH" << std::endl;
+  fc << "void" << std::endl;
+  fc << kn << args << std::endl;
+  fc << "{" << std::endl;
+
+  symbol moms("moms"), bcorr("boundary_corrections");
+  ex m0 = Gkyl::confExpand(cbasis, moms, 0);
+  ex cE = Gkyl::confExpand(cbasis, bcorr, nu);
+
+  matrix A(n, n);
+  lst rhs;
+  for (int i=0; i<nu; ++i) {
+    ex m1 = Gkyl::confExpand(cbasis, moms, 1+i);
+    ex cM = Gkyl::confExpand(cbasis, bcorr, i);
+    set_weak_block(cbasis, A, i*nc, i*nc, m0);
+    set_weak_block(cbasis, A, i*nc, nu*nc, -cM);
+    set_weak_block(cbasis, A, nu*nc, i*nc, m1);
+  }
+  set_weak_block(cbasis, A, nu*nc, nu*nc, vdim*m0-cE);
+  for (int k=0; k<n; ++k)
+    rhs.append( indexed(moms, idx(nc+k,1)) );
+
+  struct gkyl_kern_op_count count = Gkyl::writeDenseSolve(fc, "  ", A, rhs);
+  fc << std::endl;
+  for (int k=0; k<n; ++k)
+    fc << "  prim_moms[" << k << "] = x[" << k << "];" << std::endl;
+
+  // close function
+  fc << "}" << std::endl << std::endl;
+
+  Gkyl::writeOpCount(fh, fc, kn, count);
+  fc << std::endl;
+
+  // loop over conf cells
+  fc << "GKYL_CU_DH" << std::endl;
+  fc << "void" << std::endl;
+  fc << kn << "_batch" << batch_args << std::endl;
+  fc << "{" << std::endl;
+  fc << "  for (int i=0; i<ncells; ++i)" << std::endl;
+  fc << "    " << kn << "(moms+i*" << (nu+2)*nc << ", boundary_corrections+i*" << n
+     << ", prim_moms+i*" << n << ");" << std::endl;
+  fc << "}" << std::endl << std::endl;
+}
+
+// Generates kernel computing the cross primitive moments u_sr and
+// vtSq_sr of species s colliding with species r. With
+// R = (m_r n_r nu_rs)/(m_s n_s nu_sr + m_r n_r nu_rs), computed by weak
+// division, and b1 = betaGreene+1,
+//
+//   u_sr = u_s - b1*R*(u_s - u_r)
+//   vtSq_sr = vtSq_s - (u_sr.u_sr - u_s.u_s)/vdim
+//     + 2*b1*R*(m_r vtSq_r - m_s vtSq_s)/(m_s+m_r)
+//
+// which conserves momentum and energy of the pair. The weak division
+// matrix is symmetric (and positive definite), so it is solved with an
+// unrolled Cholesky factorization. Also generates a variant looping
+// over ncells consecutive conf cells. Generated function signatures:
+//
+// void foo(double betaGreenep1, double m_self, const double *nu_sr, const double *moms_self,
+//   const double *prim_moms_self, double m_other, const double *nu_rs, const double *moms_other,
+//   const double *prim_moms_other, double *prim_moms_cross)
+// void foo_batch(int ncells, <same arguments>)
+//
+// Only M0 of moms_self and moms_other is used. The layout of the
+// moments and primitive moments is as in gen_self_prim.
+//
+// fh: header file
+// fc: C file
+//
+static void
+gen_cross_prim(std::ostream& fh, std::ostream& fc, const std::string& kn,
+  const Gkyl::ModalBasis& cbasis, int nu, int vdim)
+{
+  int nc = cbasis.get_numbasis();
+  std::string pars = "double betaGreenep1, double m_self, const double *nu_sr, const double *moms_self,"
+    " const double *prim_moms_self, double m_other, const double *nu_rs, const double *moms_other,"
+    " const double *prim_moms_other, double *GKYL_RESTRICT prim_moms_cross )";
+  std::string args = "(" + pars;
+  std::string batch_args = "(int ncells, " + pars;
+
+  // function declarations
+  fh << std::endl << "GKYL_CU_DH void " << kn << args << ";" << std::endl;
+  fh << "GKYL_CU_DH void " << kn << "_batch" << batch_args << ";" << std::endl;
+
+  // function definition
+  fc << "GKYL_CU_DH" << std::endl;
+  fc << "void" << std::endl;
+  fc << kn << args << std::endl;
+  fc << "{" << std::endl;
+
+  symbol b1("betaGreenep1"), ms("m_self"), mr("m_other");
+  symbol nusr("nu_sr"), nurs("nu_rs"), moms_s("moms_self"), moms_r("moms_other");
+  symbol prim_s("prim_moms_self"), prim_r("prim_moms_other"), prim_x("prim_moms_cross");
+  symbol x("x");
+
+  // weak products m n nu of each species and weak division by their sum
+  lst mnu_s = cbasis.project(ms*Gkyl::confExpand(cbasis, moms_s, 0)*Gkyl::confExpand(cbasis, nusr, 0));
+  lst mnu_r = cbasis.project(mr*Gkyl::confExpand(cbasis, moms_r, 0)*Gkyl::confExpand(cbasis, nurs, 0));
+  lst bc = cbasis.get_basis();
+  ex den = 0;
+  for (int k=0; k<nc; ++k)
+    den += bc[k]*(mnu_s[k]+mnu_r[k]).expand();
+
+  matrix A(nc, nc);
+  set_weak_block(cbasis, A, 0, 0, den);
+  struct gkyl_kern_op_count count = Gkyl::writeDenseSolve(fc, "  ", A, mnu_r);
+  fc << std::endl;
+
+  ex R = Gkyl::confExpand(cbasis, x, 0);
+  ex usq_x = 0, usq_s = 0;
+  for (int i=0; i<nu; ++i) {
+    ex us = Gkyl::confExpand(cbasis, prim_s, i), ur = Gkyl::confExpand(cbasis, prim_r, i);
+    lst ux = cbasis.project(us - b1*R*(us-ur));
+    for (int k=0; k<nc; ++k) {
+      ex uk = ux[k].expand().evalf();
+      fc << "  prim_moms_cross[" << i*nc+k << "] = " << csrc << uk << ";" << std::endl;
+      count = Gkyl::addOps(count, Gkyl::countOps(uk));
+    }
+    ex uxe = Gkyl::confExpand(cbasis, prim_x, i);
+    usq_x += uxe*uxe;
+    usq_s += us*us;
+  }
+
+  ex vtsq_s = Gkyl::confExpand(cbasis, prim_s, nu), vtsq_r = Gkyl::confExpand(cbasis, prim_r, nu);
+  lst vx = cbasis.project(vtsq_s - (usq_x-usq_s)/vdim + 2*b1*R*(mr*vtsq_r-ms*vtsq_s)/(ms+mr));
+  for (int k=0; k<nc; ++k) {
+    ex vk = vx[k].expand().evalf();
+    fc << "  prim_moms_cross[" << nu*nc+k << "] = " << csrc << vk << ";" << std::endl;
+    count = Gkyl::addOps(count, Gkyl::countOps(vk));
+  }
+
+  // close function
+  fc << "}" << std::endl << std::endl;
+
+  Gkyl::writeOpCount(fh, fc, kn, count);
+  fc << std::endl;
+
+  // loop over conf cells
+  int nm = (nu+2)*nc, np = (nu+1)*nc;
+  fc << "GKYL_CU_DH" << std::endl;
+  fc << "void" << std::endl;
+  fc << kn << "_batch" << batch_args << std::endl;
+  fc << "{" << std::endl;
+  fc << "  for (int i=0; i<ncells; ++i)" << std::endl;
+  fc << "    " << kn << "(betaGreenep1, m_self, nu_sr+i*" << nc << ", moms_self+i*" << nm
+     << ", prim_moms_self+i*" << np << "," << std::endl;
+  fc << "      m_other, nu_rs+i*" << nc << ", moms_other+i*" << nm
+     << ", prim_moms_other+i*" << np << ", prim_moms_cross+i*" << np << ");" << std::endl;
+  fc << "}" << std::endl << std::endl;
+}
+
+// Writes source files for the self and cross primitive moment kernels
+// with prefix pre and suffix suf
+static void
+gen_prim_files(std::ostream& fh, const char *buff, const std::string& pre, const std::string& suf,
+  const Gkyl::ModalBasis& cbasis, int nu, int vdim)
+{
+  // each function is written to its own file to allow building
+  // kernels in parallel
+  std::string kn_self = pre + "_self_prim_moments_" + suf;
+  std::ofstream self_file_c(("kernels/prim_moments/" + kn_self + ".c").c_str(), std::ofstream::out);
+  self_file_c << "// " << buff << std::endl;
+  self_file_c << "#include <math.h>" << std::endl;
+  self_file_c << "#include <gkyl_prim_moments_kernels.h>" << std::endl;
+  gen_self_prim(fh, self_file_c, kn_self, cbasis, nu, vdim);
+
+  std::string kn_cross = pre + "_cross_prim_moments_" + suf;
+  std::ofstream cross_file_c(("kernels/prim_moments/" + kn_cross + ".c").c_str(), std::ofstream::out);
+  cross_file_c << "// " << buff << std::endl;
+  cross_file_c << "#include <math.h>" << std::endl;
+  cross_file_c << "#include <gkyl_prim_moments_kernels.h>" << std::endl;
+  gen_cross_prim(fh, cross_file_c, kn_cross, cbasis, nu, vdim);
+}
+
+void
+gen_all_prim_moments()
+{
+  // compute time-stamp
+  char buff[70];
+  time_t t = time(NULL);
+  struct tm curr_tm = *localtime(&t);
+  strftime(buff, sizeof buff, "%c", &curr_tm);
+
+  symbol z0("z0"), z1("z1"), z2("z2"), z3("z3"), z4("z4"), z5("z5");
+  std::vector<symbol> vars { z0, z1, z2, z3, z4, z5 };
+
+  std::ofstream prim_file_h("kernels/prim_moments/gkyl_prim_moments_kernels.h", std::ofstream::out);
+  prim_file_h << "// " << buff << std::endl;
+  prim_file_h << "#pragma once" << std::endl;
+  prim_file_h << "#include <gkyl_util.h>" << std::endl;
+  prim_file_h << "EXTERN_C_BEG" << std::endl;
+
+  struct timespec tstart = gkyl_wall_clock();
+
+  // Vlasov: the kernels depend only on the conf basis, so the ser p1
+  // kernels are also used with the hybrid basis. 3x p2 is skipped as
+  // its self system (80 unknowns for 3v) is too large to unroll
+  for (int cdim=1; cdim<=3; ++cdim) {
+    for (int vdim=cdim; vdim<=3; ++vdim) {
+      for (int p=1; p<=(cdim<3 ? 2 : 1); ++p) {
+        std::cout << cdim << "x" << vdim << "v" << "p" << p << " " << std::flush;
+        Gkyl::ModalBasis cbasis(Gkyl::MODAL_SER, cdim, 0, vars, p);
+        std::ostringstream suf;
+        suf << cdim << "x" << vdim << "v_ser_" << "p" << p;
+        gen_prim_files(prim_file_h, buff, "vlasov", suf.str(), cbasis, vdim, vdim);
+      }
+    }
+  }
+  std::cout << std::endl;
+
+  // gyrokinetics: parallel flow only, and vtSq has 3 degrees of
+  // freedom in M2 when the magnetic moment is a coordinate
+  for (int cdim=1; cdim<=3; ++cdim) {
+    for (int vdim=std::min(cdim,2); vdim<=2; ++vdim) {
+      int p = 1;
+      std::cout << cdim << "x" << vdim << "v" << "p" << p << " (gkhyb) " << std::flush;
+      Gkyl::ModalBasis cbasis(Gkyl::MODAL_SER, cdim, 0, vars, p);
+      std::ostringstream suf;
+      suf << cdim << "x" << vdim << "v_gkhyb_" << "p" << p;
+      gen_prim_files(prim_file_h, buff, "gyrokinetic", suf.str(), cbasis, 1, vdim==1 ? 1 : 3);
+    }
+  }
+  std::cout << std::endl;
+
+  prim_file_h << "EXTERN_C_END" << std::endl;
+
+  double tm = gkyl_time_diff_now_sec(tstart);
+  std::cout << "Took " << tm << " seconds" << std::endl;
+}
+
+int
+main(int argc, char **argv)
+{
+  gen_all_prim_moments();
+
+  return 1;
+}
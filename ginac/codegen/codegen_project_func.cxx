@@ -0,0 +1,187 @@
+#include <modal_basis.h>
+#include <kernel_util.h>
+#include <algorithm>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <gkyl_util.h>
+
+using namespace GiNaC;
+
+// Builtin functions: name, extra parameter and C expression of the
+// value at the node fq[q]
+static const struct {
+  const char *name, *param, *expr;
+} builtins[] = {
+  { "sqrt", "", "sqrt(fq[q])" },
+  { "exp", "double a, ", "exp(a*fq[q])" },
+  { "log", "", "log(fq[q])" },
+  { "recip", "", "1.0/fq[q]" },
+  { "pow", "double a, ", "pow(fq[q], a)" },
+};
+
+// Generates kernels projecting a function of an expansion on the
+// basis. The expansion is evaluated at the nodes of the tensor
+// Gauss-Legendre rule with deg+1 points per direction (deg: highest
+// degree of the basis in any direction), which is exact for the mass
+// matrix, the function is applied at each node and the result is
+// projected back. The node values of the basis are folded into
+// sum-factorized passes with constant coefficients. Generated function
+// signatures:
+//
+// void project_func_to_nodes_foo(const double *f, double *fq)
+// void project_func_from_nodes_foo(const double *fq, double *out)
+// void project_func_foo(double (*func)(double x, void *ctx), void *ctx, const double *f, double *out)
+// void project_func_sqrt_foo(const double *f, double *out)
+// void project_func_exp_foo(double a, const double *f, double *out)
+// void project_func_log_foo(const double *f, double *out)
+// void project_func_recip_foo(const double *f, double *out)
+// void project_func_pow_foo(double a, const double *f, double *out)
+//
+// The exp kernel projects exp(a*f) and the pow kernel f^a. All of them
+// are written to the same file, so the compiler can inline the node
+// passes and the callback. out can alias f.
+//
+// fh: header file
+// fc: C file
+//
+static void
+gen_project_func(std::ostream& fh, std::ostream& fc, const std::string& suf, const Gkyl::ModalBasis& basis)
+{
+  int ndim = basis.get_ndim();
+  lst bc = basis.get_basis();
+
+  int deg = 0;
+  for (int k=0; k<basis.get_numbasis(); ++k)
+    for (int d=0; d<ndim; ++d)
+      deg = std::max(deg, bc[k].degree(basis.get_var(d)));
+  int n = deg+1, nq = 1;
+  for (int d=0; d<ndim; ++d) nq *= n;
+
+  std::string tn = "project_func_to_nodes_" + suf, fn = "project_func_from_nodes_" + suf;
+
+  // function declarations
+  fh << std::endl;
+  fh << "GKYL_CU_DH void " << tn << "(const double *GKYL_RESTRICT f, double *GKYL_RESTRICT fq);" << std::endl;
+  fh << "GKYL_CU_DH void " << fn << "(const double *GKYL_RESTRICT fq, double *GKYL_RESTRICT out);" << std::endl;
+  fh << "GKYL_CU_DH void project_func_" << suf
+     << "(double (*func)(double x, void *ctx), void *ctx, const double *f, double *out);" << std::endl;
+  for (size_t b=0; b<sizeof(builtins)/sizeof(builtins[0]); ++b)
+    fh << "GKYL_CU_DH void project_func_" << builtins[b].name << "_" << suf
+       << "(" << builtins[b].param << "const double *f, double *out);" << std::endl;
+
+  // values at the nodes
+  fc << "GKYL_CU_DH" << std::endl;
+  fc << "void" << std::endl;
+  fc << tn << "(const double *GKYL_RESTRICT f, double *GKYL_RESTRICT fq)" << std::endl;
+  fc << "{" << std::endl;
+  struct gkyl_kern_op_count tcount = Gkyl::writeQuadEval(fc, "  ", basis, n, "f", "fq");
+  fc << "}" << std::endl << std::endl;
+  Gkyl::writeOpCount(fh, fc, tn, tcount);
+  fc << std::endl;
+
+  // projection of the node values
+  fc << "GKYL_CU_DH" << std::endl;
+  fc << "void" << std::endl;
+  fc << fn << "(const double *GKYL_RESTRICT fq, double *GKYL_RESTRICT out)" << std::endl;
+  fc << "{" << std::endl;
+  struct gkyl_kern_op_count fcount = Gkyl::writeQuadProject(fc, "  ", basis, n, "fq", "out");
+  fc << "}" << std::endl << std::endl;
+  Gkyl::writeOpCount(fh, fc, fn, fcount);
+  fc << std::endl;
+
+  // callback and builtin functions
+  fc << "GKYL_CU_DH" << std::endl;
+  fc << "void" << std::endl;
+  fc << "project_func_" << suf
+     << "(double (*func)(double x, void *ctx), void *ctx, const double *f, double *out)" << std::endl;
+  fc << "{" << std::endl;
+  fc << "  double fq[" << nq << "];" << std::endl;
+  fc << "  " << tn << "(f, fq);" << std::endl;
+  fc << "  for (int q=0; q<" << nq << "; ++q) fq[q] = func(fq[q], ctx);" << std::endl;
+  fc << "  " << fn << "(fq, out);" << std::endl;
+  fc << "}" << std::endl << std::endl;
+
+  for (size_t b=0; b<sizeof(builtins)/sizeof(builtins[0]); ++b) {
+    fc << "GKYL_CU_DH" << std::endl;
+    fc << "void" << std::endl;
+    fc << "project_func_" << builtins[b].name << "_" << suf
+       << "(" << builtins[b].param << "const double *f, double *out)" << std::endl;
+    fc << "{" << std::endl;
+    fc << "  double fq[" << nq << "];" << std::endl;
+    fc << "  " << tn << "(f, fq);" << std::endl;
+    fc << "  for (int q=0; q<" << nq << "; ++q) fq[q] = " << builtins[b].expr << ";" << std::endl;
+    fc << "  " << fn << "(fq, out);" << std::endl;
+    fc << "}" << std::endl << std::endl;
+  }
+}
+
+// Writes source file for the kernels with suffix suf
+static void
+gen_project_func_file(std::ostream& fh, const char *buff, const std::string& suf,
+  const Gkyl::ModalBasis& basis)
+{
+  // each basis is written to its own file to allow building kernels
+  // in parallel
+  std::ofstream pf_file_c(("kernels/project_func/project_func_" + suf + ".c").c_str(), std::ofstream::out);
+  pf_file_c << "// " << buff << std::endl;
+  pf_file_c << "#include <math.h>" << std::endl;
+  pf_file_c << "#include <gkyl_project_func_kernels.h>" << std::endl;
+  gen_project_func(fh, pf_file_c, suf, basis);
+}
+
+void
+gen_all_project_func()
+{
+  // compute time-stamp
+  char buff[70];
+  time_t t = time(NULL);
+  struct tm curr_tm = *localtime(&t);
+  strftime(buff, sizeof buff, "%c", &curr_tm);
+
+  symbol z0("z0"), z1("z1"), z2("z2"), z3("z3"), z4("z4"), z5("z5");
+  std::vector<symbol> vars { z0, z1, z2, z3, z4, z5 };
+
+  // nodes and weights are computed well beyond double precision
+  Digits = 32;
+
+  std::ofstream pf_file_h("kernels/project_func/gkyl_project_func_kernels.h", std::ofstream::out);
+  pf_file_h << "// " << buff << std::endl;
+  pf_file_h << "#pragma once" << std::endl;
+  pf_file_h << "#include <gkyl_util.h>" << std::endl;
+  pf_file_h << "EXTERN_C_BEG" << std::endl;
+
+  struct timespec tstart = gkyl_wall_clock();
+
+  // conf-space bases
+  for (int dim=1; dim<=3; ++dim) {
+    for (int p=1; p<=3; ++p) {
+      std::cout << dim << "dp" << p << " " << std::flush;
+      Gkyl::ModalBasis basis(Gkyl::MODAL_SER, dim, 0, vars, p);
+      std::ostringstream suf;
+      suf << dim << "d_ser_p" << p;
+      gen_project_func_file(pf_file_h, buff, suf.str(), basis);
+    }
+  }
+  for (int dim=2; dim<=3; ++dim) {
+    std::cout << dim << "dp2 (tensor) " << std::flush;
+    Gkyl::ModalBasis basis(Gkyl::MODAL_TEN, dim, 0, vars, 2);
+    std::ostringstream suf;
+    suf << dim << "d_tensor_p2";
+    gen_project_func_file(pf_file_h, buff, suf.str(), basis);
+  }
+  std::cout << std::endl;
+
+  pf_file_h << "EXTERN_C_END" << std::endl;
+
+  double tm = gkyl_time_diff_now_sec(tstart);
+  std::cout << "Took " << tm << " seconds" << std::endl;
+}
+
+int
+main(int argc, char **argv)
+{
+  gen_all_project_func();
+
+  return 1;
+}
@@ -0,0 +1,404 @@
+#include <modal_basis.h>
+#include <kernel_util.h>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <gkyl_util.h>
+
+using namespace GiNaC;
+
+// Computes the phase-space characteristic velocity of the
+// Vlasov-Maxwell system in direction dir, scaled by 2/dxv[dir] so that
+// it multiplies derivatives in logical coordinates. Configuration-space
+// directions stream with the velocity v = w+dxv/2*z, velocity-space
+// directions are accelerated by qmem = q/m*(E,B).
+static ex
+calc_vlasov_alpha(int dir, const Gkyl::ModalBasis& cbasis, const Gkyl::ModalBasis& pbasis,
+  const symbol& w, const symbol& dxv, const symbol& qmem)
+{
+  int cdim = cbasis.get_ndim(), vdim = pbasis.get_ndim()-cdim;
+  int nc = cbasis.get_numbasis();
+  lst cbc = cbasis.get_basis();
+
+  // velocity components (zero for components not in the model)
+  ex vel[3] = { 0, 0, 0 };
+  for (int j=0; j<vdim; ++j)
+    vel[j] = indexed(w, idx(cdim+j,1)) + indexed(dxv, idx(cdim+j,1))/2*pbasis.get_var(cdim+j);
+
+  // rdx2 = 2/dxv[dir]
+  ex rdx2 = 2/indexed(dxv, idx(dir,1));
+
+  if (dir < cdim)
+    return rdx2*vel[dir];
+
+  // q/m*E and q/m*B as configuration space expansions
+  ex E[3], B[3];
+  for (int j=0; j<3; ++j) {
+    E[j] = 0; B[j] = 0;
+    for (int k=0; k<nc; ++k) {
+      E[j] += cbc[k]*indexed(qmem, idx(j*nc+k,1));
+      B[j] += cbc[k]*indexed(qmem, idx((3+j)*nc+k,1));
+    }
+  }
+
+  int j = dir-cdim;
+  ex vxB = vel[(j+1)%3]*B[(j+2)%3] - vel[(j+2)%3]*B[(j+1)%3];
+  return rdx2*(E[j] + vxB);
+}
+
+// Generates Vlasov-Maxwell volume kernel. The characteristic
+// velocities are projected on the phase-space basis once, and the
+// volume term is collected w.r.t. the coefficients of f, with
+// repeated coefficient combinations shared between all outputs.
+// Generated function signature:
+//
+// double foo(const double *w, const double *dxv, const double *qmem, const double *f, double *out)
+//
+// w: cell-center coordinates
+// dxv: cell spacing
+// qmem: q/m*EM fields, components (Ex,Ey,Ez,Bx,By,Bz) each expanded in conf basis
+// f: distribution function
+// out: volume term is accumulated into this
+//
+// Returns estimate of the CFL frequency at the cell-center.
+//
+// fh: header file
+// fc: C file
+//
+static void
+gen_vlasov_vol(std::ostream& fh, std::ostream& fc,
+  const Gkyl::ModalBasis& cbasis, const Gkyl::ModalBasis& pbasis)
+{
+  int cdim = cbasis.get_ndim(), pdim = pbasis.get_ndim(), vdim = pdim-cdim;
+  int polyOrder = pbasis.get_polyOrder(), np = pbasis.get_numbasis();
+  lst bc = pbasis.get_basis();
+
+  std::ostringstream kn;
+  kn << "vlasov_vol_" << cdim << "x" << vdim << "v_ser_" << "p" << polyOrder;
+
+  // function declaration
+  fh << std::endl
+     << "GKYL_CU_DH double " << kn.str()
+     << "(const double *w, const double *dxv, const double *qmem, const double *f, double *GKYL_RESTRICT out );"
+     << std::endl;
+
+  // function definition
+  fc << "GKYL_CU_DH" << std::endl;
+  fc << "double" << std::endl;
+  fc << kn.str()
+     << "(const double *w, const double *dxv, const double *qmem, const double *f, double *GKYL_RESTRICT out )"
+     << std::endl;
+  fc << "{" << std::endl;
+
+  struct gkyl_kern_op_count count = { 0 };
+  symbol w("w"), dxv("dxv"), qmem("qmem"), f("f"), alpha("alpha");
+
+  // characteristic velocities projected on phase basis; only non-zero
+  // coefficients are stored and used
+  fc << "  double alpha[" << pdim*np << "];" << std::endl;
+  std::vector<ex> alpha_expand(pdim);
+  exmap center;
+  for (int d=0; d<pdim; ++d) center[pbasis.get_var(d)] = 0;
+
+  fc << "  double cflFreq_mid = 0.0;" << std::endl;
+  for (int d=0; d<pdim; ++d) {
+    std::cout << "alpha" << d << " " << std::flush;
+    lst ac = pbasis.project(calc_vlasov_alpha(d, cbasis, pbasis, w, dxv, qmem));
+    alpha_expand[d] = 0;
+    for (int k=0; k<np; ++k) {
+      if (ac[k].is_zero()) continue;
+      auto ack = ac[k].evalf();
+      fc << "  alpha[" << d*np+k << "] = " << csrc << ack << ";" << std::endl;
+      count = Gkyl::addOps(count, Gkyl::countOps(ack));
+      alpha_expand[d] += bc[k]*indexed(alpha, idx(d*np+k,1));
+    }
+    auto amid = alpha_expand[d].subs(center).expand().evalf();
+    fc << "  cflFreq_mid += " << 2*polyOrder+1 << "*fabs(" << csrc << amid << ");" << std::endl;
+    count = Gkyl::addOps(count, Gkyl::countOps(amid));
+    count.num_sum += 1; count.num_prod += 1;
+  }
+  std::cout << std::endl;
+  fc << std::endl;
+
+  // volume term out_l = sum_d < d b_l/dz_d, alpha_d f >
+  count = Gkyl::addOps(count, Gkyl::writeVolTerm(fc, pbasis, alpha_expand, f));
+  fc << std::endl;
+
+  fc << "  return cflFreq_mid;" << std::endl;
+  // close function
+  fc << "}" << std::endl << std::endl;
+
+  Gkyl::writeOpCount(fh, fc, kn.str(), count);
+}
+
+static const char *dir_names[] = { "x", "y", "z" };
+
+// Generates Vlasov-Maxwell surface kernel in direction dir. The
+// restriction of the neighbor expansions to the faces, the upwinded
+// numerical flux and the lift of the flux into the volume are fused
+// so no surface arrays are needed outside the kernel. Streaming
+// directions upwind with the sign of the cell-center velocity,
+// acceleration directions use a Lax-Friedrichs flux with
+// amax = bound of |alpha| on the face. Generated function signatures:
+//
+// void foo(const double *w, const double *dxv, const double *fl, const double *fc, const double *fr, double *out)
+// void foo(const double *w, const double *dxv, const double *qmem, const double *fl, const double *fc, const double *fr, double *out)
+//
+// The second form is used for velocity directions.
+//
+// fh: header file
+// fc: C file
+//
+static void
+gen_vlasov_surf(std::ostream& fh, std::ostream& fc,
+  const Gkyl::ModalBasis& cbasis, const Gkyl::ModalBasis& pbasis, int dir)
+{
+  int cdim = cbasis.get_ndim(), pdim = pbasis.get_ndim(), vdim = pdim-cdim;
+  int polyOrder = pbasis.get_polyOrder();
+  bool is_vel = dir >= cdim;
+
+  std::ostringstream kn;
+  kn << "vlasov_surf" << (is_vel ? "v" : "") << dir_names[is_vel ? dir-cdim : dir]
+     << "_" << cdim << "x" << vdim << "v_ser_" << "p" << polyOrder;
+  std::string args = is_vel ?
+    "(const double *w, const double *dxv, const double *qmem, const double *fl, const double *fc, const double *fr, double *GKYL_RESTRICT out )" :
+    "(const double *w, const double *dxv, const double *fl, const double *fc, const double *fr, double *GKYL_RESTRICT out )";
+
+  // function declaration
+  fh << std::endl << "GKYL_CU_DH void " << kn.str() << args << ";" << std::endl;
+
+  // function definition
+  fc << "GKYL_CU_DH" << std::endl;
+  fc << "void" << std::endl;
+  fc << kn.str() << args << std::endl;
+  fc << "{" << std::endl;
+
+  struct gkyl_kern_op_count count = { 0 };
+  symbol w("w"), dxv("dxv"), qmem("qmem"), fls("fl"), fcs("fc"), frs("fr");
+  Gkyl::ModalBasis sbasis = pbasis.surfBasis(dir);
+  int ns = sbasis.get_numbasis();
+
+  ex alpha_dir = calc_vlasov_alpha(dir, cbasis, pbasis, w, dxv, qmem);
+
+  // neighbor expansions restricted to the two faces of the cell
+  ex fl_r = Gkyl::faceExpand(pbasis, fls, dir, 1), fc_l = Gkyl::faceExpand(pbasis, fcs, dir, -1);
+  ex fc_r = Gkyl::faceExpand(pbasis, fcs, dir, 1), fr_l = Gkyl::faceExpand(pbasis, frs, dir, -1);
+
+  fc << "  double Ghat_l[" << ns << "], Ghat_r[" << ns << "];" << std::endl;
+  if (!is_vel) {
+    // alpha = 2/dxv*v only depends on the velocity coordinate
+    fc << "  if (w[" << cdim+dir << "] > 0) {" << std::endl;
+    count = Gkyl::addOps(count, Gkyl::writeAssign(fc, "    ", "Ghat_l", sbasis.project(alpha_dir*fl_r)));
+    count = Gkyl::addOps(count, Gkyl::writeAssign(fc, "    ", "Ghat_r", sbasis.project(alpha_dir*fc_r)));
+    fc << "  } else {" << std::endl;
+    Gkyl::writeAssign(fc, "    ", "Ghat_l", sbasis.project(alpha_dir*fc_l));
+    Gkyl::writeAssign(fc, "    ", "Ghat_r", sbasis.project(alpha_dir*fr_l));
+    fc << "  }" << std::endl;
+  }
+  else {
+    fc << "  double amax = 0.0;" << std::endl;
+    ex alpha_expand = Gkyl::writeSurfAlpha(fc, "  ", sbasis, alpha_dir, count);
+    count = Gkyl::addOps(count, Gkyl::writeAssign(fc, "  ", "Ghat_l", Gkyl::calcLaxFlux(sbasis, alpha_expand, fl_r, fc_l)));
+    count = Gkyl::addOps(count, Gkyl::writeAssign(fc, "  ", "Ghat_r", Gkyl::calcLaxFlux(sbasis, alpha_expand, fc_r, fr_l)));
+  }
+  fc << std::endl;
+
+  count = Gkyl::addOps(count, Gkyl::writeLift(fc, "  ", pbasis, sbasis, dir, true, true));
+
+  // close function
+  fc << "}" << std::endl << std::endl;
+
+  Gkyl::writeOpCount(fh, fc, kn.str(), count);
+}
+
+// Generates Vlasov-Maxwell boundary surface kernel in velocity
+// direction dir. Only the flux through the face shared by the skin
+// cell and its neighbor is computed: the face on the domain boundary
+// has zero flux. Generated function signature:
+//
+// void foo(const double *w, const double *dxv, const double *qmem, int edge, const double *fskin, const double *fedge, double *out)
+//
+// edge: -1 if the skin cell is at the lower boundary, +1 if at the upper boundary
+// fskin: distribution function in skin cell
+// fedge: distribution function in neighbor of the skin cell
+//
+// fh: header file
+// fc: C file
+//
+static void
+gen_vlasov_boundary_surf(std::ostream& fh, std::ostream& fc,
+  const Gkyl::ModalBasis& cbasis, const Gkyl::ModalBasis& pbasis, int dir)
+{
+  int cdim = cbasis.get_ndim(), pdim = pbasis.get_ndim(), vdim = pdim-cdim;
+  int polyOrder = pbasis.get_polyOrder();
+
+  std::ostringstream kn;
+  kn << "vlasov_boundary_surfv" << dir_names[dir-cdim]
+     << "_" << cdim << "x" << vdim << "v_ser_" << "p" << polyOrder;
+  std::string args =
+    "(const double *w, const double *dxv, const double *qmem, int edge, const double *fskin, const double *fedge, double *GKYL_RESTRICT out )";
+
+  // function declaration
+  fh << std::endl << "GKYL_CU_DH void " << kn.str() << args << ";" << std::endl;
+
+  // function definition
+  fc << "GKYL_CU_DH" << std::endl;
+  fc << "void" << std::endl;
+  fc << kn.str() << args << std::endl;
+  fc << "{" << std::endl;
+
+  struct gkyl_kern_op_count count = { 0 };
+  symbol w("w"), dxv("dxv"), qmem("qmem"), fskin("fskin"), fedge("fedge");
+  Gkyl::ModalBasis sbasis = pbasis.surfBasis(dir);
+  int ns = sbasis.get_numbasis();
+
+  ex alpha_dir = calc_vlasov_alpha(dir, cbasis, pbasis, w, dxv, qmem);
+  fc << "  double amax = 0.0;" << std::endl;
+  ex alpha_expand = Gkyl::writeSurfAlpha(fc, "  ", sbasis, alpha_dir, count);
+  fc << std::endl;
+
+  // skin cell at lower boundary: neighbor is to the right
+  fc << "  if (edge == -1) {" << std::endl;
+  fc << "    double Ghat_r[" << ns << "];" << std::endl;
+  lst flux_r = Gkyl::calcLaxFlux(sbasis, alpha_expand,
+    Gkyl::faceExpand(pbasis, fskin, dir, 1), Gkyl::faceExpand(pbasis, fedge, dir, -1));
+  count = Gkyl::addOps(count, Gkyl::writeAssign(fc, "    ", "Ghat_r", flux_r));
+  count = Gkyl::addOps(count, Gkyl::writeLift(fc, "    ", pbasis, sbasis, dir, false, true));
+  fc << "  }" << std::endl;
+
+  // skin cell at upper boundary: neighbor is to the left
+  fc << "  else {" << std::endl;
+  fc << "    double Ghat_l[" << ns << "];" << std::endl;
+  lst flux_l = Gkyl::calcLaxFlux(sbasis, alpha_expand,
+    Gkyl::faceExpand(pbasis, fedge, dir, 1), Gkyl::faceExpand(pbasis, fskin, dir, -1));
+  Gkyl::writeAssign(fc, "    ", "Ghat_l", flux_l);
+  Gkyl::writeLift(fc, "    ", pbasis, sbasis, dir, true, false);
+  fc << "  }" << std::endl;
+
+  // close function
+  fc << "}" << std::endl << std::endl;
+
+  // only one of the branches is executed
+  Gkyl::writeOpCount(fh, fc, kn.str(), count);
+}
+
+void
+gen_all_vlasov_vol()
+{
+  // compute time-stamp
+  char buff[70];
+  time_t t = time(NULL);
+  struct tm curr_tm = *localtime(&t);
+  strftime(buff, sizeof buff, "%c", &curr_tm);
+
+  symbol z0("z0"), z1("z1"), z2("z2"), z3("z3"), z4("z4"), z5("z5");
+  std::vector<symbol> vars { z0, z1, z2, z3, z4, z5 };
+
+  std::ofstream vol_file_h("kernels/vlasov/gkyl_vlasov_vol_kernels.h", std::ofstream::out);
+  vol_file_h << "// " << buff << std::endl;
+  vol_file_h << "#pragma once" << std::endl;
+  vol_file_h << "#include <gkyl_util.h>" << std::endl;
+  vol_file_h << "EXTERN_C_BEG" << std::endl;
+
+  struct timespec tstart = gkyl_wall_clock();
+
+  for (int cdim=1; cdim<=3; ++cdim) {
+    for (int vdim=cdim; vdim<=3; ++vdim) {
+      for (int p=1; p<=2; ++p) {
+        std::cout << cdim << "x" << vdim << "v" << "p" << p << " " << std::flush;
+        Gkyl::ModalBasis cbasis(Gkyl::MODAL_SER, cdim, 0, vars, p);
+        Gkyl::ModalBasis pbasis(Gkyl::MODAL_SER, cdim+vdim, 0, vars, p);
+
+        // each function is written to its own file to allow building
+        // kernels in parallel
+        std::ostringstream fn;
+        fn << "kernels/vlasov/vlasov_vol_" << cdim << "x" << vdim << "v_ser_" << "p" << p << ".c";
+        std::ofstream vol_file_c(fn.str().c_str(), std::ofstream::out);
+        vol_file_c << "// " << buff << std::endl;
+        vol_file_c << "#include <math.h>" << std::endl;
+        vol_file_c << "#include <gkyl_vlasov_vol_kernels.h>" << std::endl;
+
+        gen_vlasov_vol(vol_file_h, vol_file_c, cbasis, pbasis);
+      }
+    }
+  }
+
+  vol_file_h << "EXTERN_C_END" << std::endl;
+
+  double tm = gkyl_time_diff_now_sec(tstart);
+  std::cout << "Took " << tm << " seconds" << std::endl;
+}
+
+void
+gen_all_vlasov_surf()
+{
+  // compute time-stamp
+  char buff[70];
+  time_t t = time(NULL);
+  struct tm curr_tm = *localtime(&t);
+  strftime(buff, sizeof buff, "%c", &curr_tm);
+
+  symbol z0("z0"), z1("z1"), z2("z2"), z3("z3"), z4("z4"), z5("z5");
+  std::vector<symbol> vars { z0, z1, z2, z3, z4, z5 };
+
+  std::ofstream surf_file_h("kernels/vlasov/gkyl_vlasov_surf_kernels.h", std::ofstream::out);
+  surf_file_h << "// " << buff << std::endl;
+  surf_file_h << "#pragma once" << std::endl;
+  surf_file_h << "#include <gkyl_util.h>" << std::endl;
+  surf_file_h << "EXTERN_C_BEG" << std::endl;
+
+  struct timespec tstart = gkyl_wall_clock();
+
+  for (int cdim=1; cdim<=3; ++cdim) {
+    for (int vdim=cdim; vdim<=3; ++vdim) {
+      for (int p=1; p<=2; ++p) {
+        std::cout << cdim << "x" << vdim << "v" << "p" << p << " " << std::flush;
+        Gkyl::ModalBasis cbasis(Gkyl::MODAL_SER, cdim, 0, vars, p);
+        Gkyl::ModalBasis pbasis(Gkyl::MODAL_SER, cdim+vdim, 0, vars, p);
+
+        for (int dir=0; dir<cdim+vdim; ++dir) {
+          bool is_vel = dir >= cdim;
+          const char *dn = dir_names[is_vel ? dir-cdim : dir];
+
+          // each function is written to its own file to allow building
+          // kernels in parallel
+          std::ostringstream fn;
+          fn << "kernels/vlasov/vlasov_surf" << (is_vel ? "v" : "") << dn
+             << "_" << cdim << "x" << vdim << "v_ser_" << "p" << p << ".c";
+          std::ofstream surf_file_c(fn.str().c_str(), std::ofstream::out);
+          surf_file_c << "// " << buff << std::endl;
+          surf_file_c << "#include <math.h>" << std::endl;
+          surf_file_c << "#include <gkyl_vlasov_surf_kernels.h>" << std::endl;
+
+          gen_vlasov_surf(surf_file_h, surf_file_c, cbasis, pbasis, dir);
+
+          if (is_vel) {
+            std::ostringstream bfn;
+            bfn << "kernels/vlasov/vlasov_boundary_surfv" << dn
+                << "_" << cdim << "x" << vdim << "v_ser_" << "p" << p << ".c";
+            std::ofstream bsurf_file_c(bfn.str().c_str(), std::ofstream::out);
+            bsurf_file_c << "// " << buff << std::endl;
+            bsurf_file_c << "#include <math.h>" << std::endl;
+            bsurf_file_c << "#include <gkyl_vlasov_surf_kernels.h>" << std::endl;
+
+            gen_vlasov_boundary_surf(surf_file_h, bsurf_file_c, cbasis, pbasis, dir);
+          }
+        }
+      }
+    }
+  }
+
+  surf_file_h << "EXTERN_C_END" << std::endl;
+
+  double tm = gkyl_time_diff_now_sec(tstart);
+  std::cout << "Took " << tm << " seconds" << std::endl;
+}
+
+int
+main(int argc, char **argv)
+{
+  gen_all_vlasov_vol();
+  gen_all_vlasov_surf();
+
+  return 1;
+}
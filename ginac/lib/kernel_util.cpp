@@ -0,0 +1,738 @@
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <sstream>
+
+#include <kernel_util.h>
+
+struct gkyl_kern_op_count
+Gkyl::addOps(struct gkyl_kern_op_count c1, struct gkyl_kern_op_count c2)
+{
+  struct gkyl_kern_op_count count = { c1.num_sum+c2.num_sum, c1.num_prod+c2.num_prod };
+  return count;
+}
+
+struct gkyl_kern_op_count
+Gkyl::countOps(const GiNaC::ex &expr)
+{
+  struct gkyl_kern_op_count count = { 0 };
+
+  if (GiNaC::is_a<GiNaC::add>(expr)) {
+    count.num_sum += expr.nops()-1;
+    for (size_t i=0; i<expr.nops(); ++i)
+      count = addOps(count, countOps(expr.op(i)));
+  }
+  else if (GiNaC::is_a<GiNaC::mul>(expr)) {
+    count.num_prod += expr.nops()-1;
+    for (size_t i=0; i<expr.nops(); ++i)
+      count = addOps(count, countOps(expr.op(i)));
+  }
+  else if (GiNaC::is_a<GiNaC::power>(expr)) {
+    GiNaC::ex e = expr.op(1);
+    if (GiNaC::is_a<GiNaC::numeric>(e) && GiNaC::ex_to<GiNaC::numeric>(e).is_integer()) {
+      // x^n needs n-1 products, and a division if n<0
+      int n = GiNaC::ex_to<GiNaC::numeric>(e).to_int();
+      count.num_prod += std::abs(n)-1 + (n<0 ? 1 : 0);
+    }
+    else {
+      count.num_prod += 1; // sqrt, pow etc. counted as a single op
+    }
+    count = addOps(count, countOps(expr.op(0)));
+  }
+  else if (GiNaC::is_a<GiNaC::function>(expr)) {
+    for (size_t i=0; i<expr.nops(); ++i)
+      count = addOps(count, countOps(expr.op(i)));
+  }
+  // numbers, symbols and indexed objects need no ops
+
+  return count;
+}
+
+// Numeric factor of a single term of a sum
+static GiNaC::ex
+num_factor(const GiNaC::ex &t)
+{
+  if (GiNaC::is_a<GiNaC::numeric>(t))
+    return t;
+  GiNaC::ex c = 1;
+  if (GiNaC::is_a<GiNaC::mul>(t))
+    for (size_t i=0; i<t.nops(); ++i)
+      if (GiNaC::is_a<GiNaC::numeric>(t.op(i)))
+        c *= t.op(i);
+  return c;
+}
+
+// Splits term t into key*coef, where key is the factor of t that
+// appears in the set 'over', or 1 if there is no such factor
+static void
+split_term(const GiNaC::ex &t, const GiNaC::exset &over, GiNaC::ex &key, GiNaC::ex &coef)
+{
+  key = 1; coef = t;
+  if (over.count(t)) {
+    key = t; coef = 1;
+    return;
+  }
+  if (GiNaC::is_a<GiNaC::mul>(t)) {
+    for (size_t i=0; i<t.nops(); ++i)
+      if (over.count(t.op(i))) {
+        key = t.op(i);
+        coef = 1;
+        for (size_t j=0; j<t.nops(); ++j)
+          if (j != i) coef *= t.op(j);
+        return;
+      }
+  }
+}
+
+Gkyl::CSEResult
+Gkyl::cse(const GiNaC::lst &exprs, const GiNaC::lst &over, const GiNaC::symbol &tmp)
+{
+  GiNaC::exset overset(over.begin(), over.end());
+
+  // collect each expression w.r.t objects in 'over'
+  std::vector<std::map<GiNaC::ex, GiNaC::ex, GiNaC::ex_is_less> > collected;
+  for (auto eidx = exprs.begin(); eidx != exprs.end(); ++eidx) {
+    std::map<GiNaC::ex, GiNaC::ex, GiNaC::ex_is_less> cm;
+    GiNaC::ex e = eidx->expand();
+    if (GiNaC::is_a<GiNaC::add>(e)) {
+      for (size_t i=0; i<e.nops(); ++i) {
+        GiNaC::ex key, coef;
+        split_term(e.op(i), overset, key, coef);
+        cm[key] += coef;
+      }
+    }
+    else if (!e.is_zero()) {
+      GiNaC::ex key, coef;
+      split_term(e, overset, key, coef);
+      cm[key] += coef;
+    }
+    for (auto cidx = cm.begin(); cidx != cm.end(); ++cidx)
+      cidx->second = cidx->second.expand();
+    collected.push_back(cm);
+  }
+
+  // count coefficients (normalized so that the numeric factor of the
+  // first term is 1) that are sums
+  std::map<GiNaC::ex, int, GiNaC::ex_is_less> counts;
+  for (auto cm = collected.begin(); cm != collected.end(); ++cm)
+    for (auto cidx = cm->begin(); cidx != cm->end(); ++cidx)
+      if (GiNaC::is_a<GiNaC::add>(cidx->second)) {
+        GiNaC::ex norm = (cidx->second/num_factor(cidx->second.op(0))).expand();
+        counts[norm] += 1;
+      }
+
+  // repeated coefficients become temporaries, in order of first use
+  Gkyl::CSEResult res;
+  std::map<GiNaC::ex, int, GiNaC::ex_is_less> tmpidx;
+  for (auto cm = collected.begin(); cm != collected.end(); ++cm) {
+    GiNaC::ex out = 0;
+    for (auto cidx = cm->begin(); cidx != cm->end(); ++cidx) {
+      GiNaC::ex coef = cidx->second;
+      if (GiNaC::is_a<GiNaC::add>(coef)) {
+        GiNaC::ex fac = num_factor(coef.op(0));
+        GiNaC::ex norm = (coef/fac).expand();
+        if (counts[norm] > 1) {
+          if (tmpidx.count(norm) == 0) {
+            tmpidx[norm] = res.temps.nops();
+            res.temps.append(norm);
+          }
+          coef = fac*GiNaC::indexed(tmp, GiNaC::idx(tmpidx[norm],1));
+        }
+      }
+      out += cidx->first*coef;
+    }
+    res.exprs.append(out);
+  }
+  return res;
+}
+
+void
+Gkyl::writeOpCount(std::ostream &fh, std::ostream &fc, const std::string &name,
+  struct gkyl_kern_op_count count)
+{
+  fh << "struct gkyl_kern_op_count op_count_" << name << "(void);" << std::endl;
+
+  fc << "struct gkyl_kern_op_count op_count_" << name << "(void)" << std::endl;
+  fc << "{" << std::endl;
+  fc << "  return (struct gkyl_kern_op_count) { .num_sum = " << count.num_sum
+     << ", .num_prod = " << count.num_prod << " };" << std::endl;
+  fc << "}" << std::endl;
+}
+
+void
+Gkyl::writeTable(std::ostream &fc, const std::string &indent, const std::string &name,
+  const std::vector<std::vector<GiNaC::ex> > &tab)
+{
+  int n1 = tab.size(), n2 = n1 > 0 ? tab[0].size() : 0;
+  fc << indent << "static const double " << name << "[" << n1 << "][" << n2 << "] = {" << std::endl;
+  for (int i=0; i<n1; ++i) {
+    fc << indent << "  { ";
+    for (int j=0; j<n2; ++j)
+      fc << GiNaC::csrc << tab[i][j].evalf() << (j<n2-1 ? ", " : "");
+    fc << " }" << (i<n1-1 ? "," : "") << std::endl;
+  }
+  fc << indent << "};" << std::endl;
+}
+
+struct gkyl_kern_op_count
+Gkyl::writeAssign(std::ostream &fc, const std::string &indent,
+  const std::string &name, const GiNaC::lst &exprs)
+{
+  struct gkyl_kern_op_count count = { 0 };
+  for (size_t k=0; k<exprs.nops(); ++k) {
+    GiNaC::ex ek = exprs[k].evalf();
+    fc << indent << name << "[" << k << "] = " << GiNaC::csrc << ek << ";" << std::endl;
+    count = addOps(count, countOps(ek));
+  }
+  return count;
+}
+
+struct gkyl_kern_op_count
+Gkyl::writeIncrCSE(std::ostream &fc, const GiNaC::lst &exprs, const GiNaC::lst &over)
+{
+  struct gkyl_kern_op_count count = { 0 };
+
+  // share repeated coefficient combinations between outputs
+  GiNaC::symbol tmp("tmp");
+  CSEResult res = cse(exprs, over, tmp);
+  if (res.temps.nops() > 0) {
+    fc << "  double tmp[" << res.temps.nops() << "];" << std::endl;
+    count = addOps(count, writeAssign(fc, "  ", "tmp", res.temps));
+  }
+  fc << std::endl;
+  for (size_t l=0; l<exprs.nops(); ++l) {
+    GiNaC::ex ol = res.exprs[l].evalf();
+    if (ol.is_zero()) continue;
+    fc << "  out[" << l << "] += " << GiNaC::csrc << ol << ";" << std::endl;
+    count = addOps(count, countOps(ol));
+    count.num_sum += 1;
+  }
+  return count;
+}
+
+struct gkyl_kern_op_count
+Gkyl::writeVolTerm(std::ostream &fc, const ModalBasis &basis,
+  const std::vector<GiNaC::ex> &alpha, const GiNaC::symbol &f)
+{
+  struct gkyl_kern_op_count count = { 0 };
+  int np = basis.get_numbasis();
+  GiNaC::lst bc = basis.get_basis();
+
+  GiNaC::lst fsym, outs;
+  for (int m=0; m<np; ++m)
+    fsym.append( GiNaC::indexed(f, GiNaC::idx(m,1)) );
+  for (int l=0; l<np; ++l) {
+    std::cout << l << " " << std::flush;
+    GiNaC::ex out = 0;
+    for (size_t d=0; d<alpha.size(); ++d) {
+      if (alpha[d].is_zero()) continue;
+      GiNaC::lst proj_l = basis.project(GiNaC::diff(bc[l], basis.get_var(d))*alpha[d]);
+      for (int m=0; m<np; ++m)
+        out += proj_l[m]*fsym[m];
+    }
+    outs.append(out.expand());
+  }
+  std::cout << std::endl;
+
+  count = addOps(count, writeIncrCSE(fc, outs, fsym));
+  return count;
+}
+
+GiNaC::ex
+Gkyl::confExpand(const ModalBasis &basis, const GiNaC::symbol &s, int off)
+{
+  int nb = basis.get_numbasis();
+  GiNaC::lst bc = basis.get_basis();
+  GiNaC::ex e = 0;
+  for (int k=0; k<nb; ++k)
+    e += bc[k]*GiNaC::indexed(s, GiNaC::idx(off*nb+k,1));
+  return e;
+}
+
+GiNaC::ex
+Gkyl::faceExpand(const ModalBasis &basis, const GiNaC::symbol &f, int dir, int zf)
+{
+  GiNaC::exmap m; m[basis.get_var(dir)] = zf;
+  return basis.expand(f).subs(m).expand();
+}
+
+GiNaC::lst
+Gkyl::faceProject(const ModalBasis *sbasis, const GiNaC::ex &e)
+{
+  if (sbasis == NULL) {
+    GiNaC::lst pt; pt.append(e);
+    return pt;
+  }
+  return sbasis->project(e);
+}
+
+GiNaC::ex
+Gkyl::writeSurfAlpha(std::ostream &fc, const std::string &indent, const ModalBasis &sbasis,
+  const GiNaC::ex &alpha, struct gkyl_kern_op_count &count)
+{
+  int ns = sbasis.get_numbasis();
+  GiNaC::lst sbc = sbasis.get_basis();
+  GiNaC::symbol as("alpha");
+
+  // orthonormal product-Legendre functions are largest at the corners
+  GiNaC::exmap corner;
+  for (int d=0; d<sbasis.get_ndim(); ++d) corner[sbasis.get_var(d)] = 1;
+
+  GiNaC::lst ac = sbasis.project(alpha);
+  fc << indent << "double alpha[" << ns << "];" << std::endl;
+  GiNaC::ex alpha_expand = 0;
+  for (int k=0; k<ns; ++k) {
+    if (ac[k].is_zero()) continue;
+    GiNaC::ex ack = ac[k].evalf();
+    fc << indent << "alpha[" << k << "] = " << GiNaC::csrc << ack << ";" << std::endl;
+    count = addOps(count, countOps(ack));
+    alpha_expand += sbc[k]*GiNaC::indexed(as, GiNaC::idx(k,1));
+    fc << indent << "amax += " << GiNaC::abs(sbc[k].subs(corner)).evalf()
+       << "*fabs(alpha[" << k << "]);" << std::endl;
+    count.num_sum += 1; count.num_prod += 1;
+  }
+  return alpha_expand;
+}
+
+GiNaC::lst
+Gkyl::calcLaxFlux(const ModalBasis &sbasis, const GiNaC::ex &alpha,
+  const GiNaC::ex &fm, const GiNaC::ex &fp)
+{
+  GiNaC::symbol amax("amax");
+  GiNaC::lst cen = sbasis.project(alpha*(fm+fp)/2);
+  GiNaC::lst jump = sbasis.project((fp-fm)/2);
+  GiNaC::lst flux;
+  for (int k=0; k<sbasis.get_numbasis(); ++k)
+    flux.append( (cen[k] - amax*jump[k]).expand() );
+  return flux;
+}
+
+GiNaC::ex
+Gkyl::integrate1d(const GiNaC::ex &e, const GiNaC::ex &z)
+{
+  GiNaC::ex ee = e.expand(), out = 0;
+  for (int k=0; k<=ee.degree(z); k+=2)
+    out += ee.coeff(z, k)*GiNaC::numeric(2,k+1);
+  return out;
+}
+
+GiNaC::ex
+Gkyl::recoverFace(const ModalBasis &basis, int dir, const GiNaC::ex &fl, const GiNaC::ex &fr)
+{
+  GiNaC::ex z = basis.get_var(dir);
+  int p = std::max(fl.expand().degree(z), fr.expand().degree(z));
+  int n = 2*(p+1);
+
+  // the left cell is shifted by -1 and the right cell by +1, so the
+  // moment conditions are M c = rhs with a numeric matrix M
+  GiNaC::matrix M(n, n), rhs(n, 1);
+  for (int j=0; j<=p; ++j) {
+    for (int k=0; k<n; ++k) {
+      M(j,k) = Gkyl::integrate1d(GiNaC::pow(z-1,k)*GiNaC::pow(z,j), z);
+      M(p+1+j,k) = Gkyl::integrate1d(GiNaC::pow(z+1,k)*GiNaC::pow(z,j), z);
+    }
+    rhs(j,0) = Gkyl::integrate1d(fl*GiNaC::pow(z,j), z);
+    rhs(p+1+j,0) = Gkyl::integrate1d(fr*GiNaC::pow(z,j), z);
+  }
+  GiNaC::matrix c = M.inverse().mul(rhs);
+
+  GiNaC::ex g = 0;
+  for (int k=0; k<n; ++k)
+    g += c(k,0).expand()*GiNaC::pow(z,k);
+  return g;
+}
+
+struct gkyl_kern_op_count
+Gkyl::writeLift(std::ostream &fc, const std::string &indent,
+  const ModalBasis &basis, const ModalBasis &sbasis, int dir, bool with_l, bool with_r)
+{
+  struct gkyl_kern_op_count count = { 0 };
+  int ns = sbasis.get_numbasis();
+  GiNaC::lst bc = basis.get_basis();
+  GiNaC::symbol ghat_l("Ghat_l"), ghat_r("Ghat_r");
+  GiNaC::exmap ml; ml[basis.get_var(dir)] = -1;
+  GiNaC::exmap mr; mr[basis.get_var(dir)] = 1;
+
+  for (int i=0; i<basis.get_numbasis(); ++i) {
+    GiNaC::ex out = 0;
+    if (with_l) {
+      GiNaC::lst cl = sbasis.project(bc[i].subs(ml));
+      for (int k=0; k<ns; ++k)
+        out += cl[k]*GiNaC::indexed(ghat_l, GiNaC::idx(k,1));
+    }
+    if (with_r) {
+      GiNaC::lst cr = sbasis.project(bc[i].subs(mr));
+      for (int k=0; k<ns; ++k)
+        out -= cr[k]*GiNaC::indexed(ghat_r, GiNaC::idx(k,1));
+    }
+    out = out.expand().evalf();
+    if (out.is_zero()) continue;
+    fc << indent << "out[" << i << "] += " << GiNaC::csrc << out << ";" << std::endl;
+    count = addOps(count, countOps(out));
+    count.num_sum += 1;
+  }
+  return count;
+}
+
+// Writes "- A[r0][c0]*y[k0] - A[r1][c1]*y[k1] ..." for the terms
+// (r,c,k) listed and adds the ops to count
+static void
+write_sub_terms(std::ostream &fc, const std::vector<int> &rs, const std::vector<int> &cs,
+  const std::vector<std::string> &ys, struct gkyl_kern_op_count &count)
+{
+  for (size_t t=0; t<rs.size(); ++t)
+    fc << "-A[" << rs[t] << "][" << cs[t] << "]*" << ys[t];
+  count.num_sum += rs.size();
+  count.num_prod += rs.size();
+}
+
+struct gkyl_kern_op_count
+Gkyl::writeDenseSolve(std::ostream &fc, const std::string &indent,
+  const GiNaC::matrix &A, const GiNaC::lst &rhs)
+{
+  struct gkyl_kern_op_count count = { 0 };
+  int n = A.rows();
+
+  bool is_sym = true;
+  for (int i=0; i<n && is_sym; ++i)
+    for (int j=0; j<i && is_sym; ++j)
+      is_sym = (A(i,j)-A(j,i)).expand().is_zero();
+
+  if (is_sym) {
+    // structure of the Cholesky factor L (lower triangle), including
+    // fill-in
+    std::vector<std::vector<bool> > nz(n, std::vector<bool>(n, false));
+    for (int j=0; j<n; ++j)
+      for (int i=j; i<n; ++i) {
+        nz[i][j] = !A(i,j).expand().is_zero();
+        for (int k=0; k<j && !nz[i][j]; ++k)
+          nz[i][j] = nz[i][k] && nz[j][k];
+      }
+
+    fc << indent << "double A[" << n << "][" << n << "], x[" << n << "], rd[" << n << "];" << std::endl;
+    for (int i=0; i<n; ++i)
+      for (int j=0; j<=i; ++j) {
+        GiNaC::ex aij = A(i,j).expand().evalf();
+        if (aij.is_zero()) continue;
+        fc << indent << "A[" << i << "][" << j << "] = " << GiNaC::csrc << aij << ";" << std::endl;
+        count = addOps(count, countOps(aij));
+      }
+    for (int i=0; i<n; ++i) {
+      GiNaC::ex ri = rhs[i].expand().evalf();
+      fc << indent << "x[" << i << "] = " << GiNaC::csrc << ri << ";" << std::endl;
+      count = addOps(count, countOps(ri));
+    }
+    fc << std::endl;
+
+    // factorization A = L.L^T, with L stored in the lower triangle of A
+    for (int j=0; j<n; ++j) {
+      std::vector<int> rs, cs; std::vector<std::string> ys;
+      for (int k=0; k<j; ++k)
+        if (nz[j][k]) {
+          rs.push_back(j); cs.push_back(k);
+          std::ostringstream y; y << "A[" << j << "][" << k << "]"; ys.push_back(y.str());
+        }
+      fc << indent << "A[" << j << "][" << j << "] = sqrt(A[" << j << "][" << j << "]";
+      write_sub_terms(fc, rs, cs, ys, count);
+      fc << ");" << std::endl;
+      fc << indent << "rd[" << j << "] = 1.0/A[" << j << "][" << j << "];" << std::endl;
+      count.num_prod += 2;
+
+      for (int i=j+1; i<n; ++i) {
+        if (!nz[i][j]) continue;
+        rs.clear(); cs.clear(); ys.clear();
+        for (int k=0; k<j; ++k)
+          if (nz[i][k] && nz[j][k]) {
+            rs.push_back(i); cs.push_back(k);
+            std::ostringstream y; y << "A[" << j << "][" << k << "]"; ys.push_back(y.str());
+          }
+        fc << indent << "A[" << i << "][" << j << "] = (";
+        if (A(i,j).expand().is_zero())
+          fc << "0.0";
+        else
+          fc << "A[" << i << "][" << j << "]";
+        write_sub_terms(fc, rs, cs, ys, count);
+        fc << ")*rd[" << j << "];" << std::endl;
+        count.num_prod += 1;
+      }
+    }
+    fc << std::endl;
+
+    // forward substitution L.y = rhs and back-substitution L^T.x = y
+    for (int i=0; i<n; ++i) {
+      std::vector<int> rs, cs; std::vector<std::string> ys;
+      for (int k=0; k<i; ++k)
+        if (nz[i][k]) {
+          rs.push_back(i); cs.push_back(k);
+          std::ostringstream y; y << "x[" << k << "]"; ys.push_back(y.str());
+        }
+      fc << indent << "x[" << i << "] = (x[" << i << "]";
+      write_sub_terms(fc, rs, cs, ys, count);
+      fc << ")*rd[" << i << "];" << std::endl;
+      count.num_prod += 1;
+    }
+    for (int i=n-1; i>=0; --i) {
+      std::vector<int> rs, cs; std::vector<std::string> ys;
+      for (int k=i+1; k<n; ++k)
+        if (nz[k][i]) {
+          rs.push_back(k); cs.push_back(i);
+          std::ostringstream y; y << "x[" << k << "]"; ys.push_back(y.str());
+        }
+      fc << indent << "x[" << i << "] = (x[" << i << "]";
+      write_sub_terms(fc, rs, cs, ys, count);
+      fc << ")*rd[" << i << "];" << std::endl;
+      count.num_prod += 1;
+    }
+  }
+  else {
+    fc << indent << "double A[" << n << "][" << n << "] = {{0.0}}, x[" << n << "];" << std::endl;
+    for (int i=0; i<n; ++i)
+      for (int j=0; j<n; ++j) {
+        GiNaC::ex aij = A(i,j).expand().evalf();
+        if (aij.is_zero()) continue;
+        fc << indent << "A[" << i << "][" << j << "] = " << GiNaC::csrc << aij << ";" << std::endl;
+        count = addOps(count, countOps(aij));
+      }
+    for (int i=0; i<n; ++i) {
+      GiNaC::ex ri = rhs[i].expand().evalf();
+      fc << indent << "x[" << i << "] = " << GiNaC::csrc << ri << ";" << std::endl;
+      count = addOps(count, countOps(ri));
+    }
+    fc << std::endl;
+
+    // LU decomposition with partial pivoting, eliminating column k
+    for (int k=0; k<n-1; ++k) {
+      fc << indent << "{" << std::endl;
+      fc << indent << "  int piv = " << k << "; double amax = fabs(A[" << k << "][" << k << "]);" << std::endl;
+      for (int r=k+1; r<n; ++r)
+        fc << indent << "  if (fabs(A[" << r << "][" << k << "]) > amax) { piv = " << r
+           << "; amax = fabs(A[" << r << "][" << k << "]); }" << std::endl;
+      fc << indent << "  if (piv != " << k << ") {" << std::endl;
+      fc << indent << "    for (int j=" << k << "; j<" << n << "; ++j) { double t = A[" << k << "][j]; A["
+         << k << "][j] = A[piv][j]; A[piv][j] = t; }" << std::endl;
+      fc << indent << "    double t = x[" << k << "]; x[" << k << "] = x[piv]; x[piv] = t;" << std::endl;
+      fc << indent << "  }" << std::endl;
+      fc << indent << "  const double rpiv = 1.0/A[" << k << "][" << k << "];" << std::endl;
+      count.num_prod += 1;
+      for (int r=k+1; r<n; ++r) {
+        fc << indent << "  { const double m = A[" << r << "][" << k << "]*rpiv;";
+        for (int j=k+1; j<n; ++j)
+          fc << " A[" << r << "][" << j << "] -= m*A[" << k << "][" << j << "];";
+        fc << " x[" << r << "] -= m*x[" << k << "]; }" << std::endl;
+        count.num_sum += n-k;
+        count.num_prod += n-k+1;
+      }
+      fc << indent << "}" << std::endl;
+    }
+    fc << std::endl;
+
+    // back-substitution
+    for (int i=n-1; i>=0; --i) {
+      std::vector<int> rs, cs; std::vector<std::string> ys;
+      for (int j=i+1; j<n; ++j) {
+        rs.push_back(i); cs.push_back(j);
+        std::ostringstream y; y << "x[" << j << "]"; ys.push_back(y.str());
+      }
+      fc << indent << "x[" << i << "] = (x[" << i << "]";
+      write_sub_terms(fc, rs, cs, ys, count);
+      fc << ")/A[" << i << "][" << i << "];" << std::endl;
+      count.num_prod += 1;
+    }
+  }
+  return count;
+}
+
+// Data for sum-factorized passes between the coefficients of basis
+// and its values at the tensor product of n 1D points. Stage d
+// holds values indexed by the nodes in directions 0..d-1 and by the
+// Legendre degrees (the tail) in directions d..ndim-1
+struct sumfac_data {
+  int ndim, n;
+  std::vector<std::vector<std::vector<int> > > tails; // tails of stage d
+  std::vector<std::map<std::vector<int>, int> > tidx; // index of tail in stage d
+  std::vector<std::vector<GiNaC::ex> > phi; // phi[a][i]: 1D function of degree a at node i
+  std::vector<GiNaC::ex> wt; // 1D weights (if the points are quadrature nodes)
+};
+
+static sumfac_data
+calc_sumfac_data(const Gkyl::ModalBasis &basis, const std::vector<GiNaC::numeric> &x,
+  const std::vector<GiNaC::numeric> &w)
+{
+  sumfac_data sd;
+  int ndim = basis.get_ndim(), nb = basis.get_numbasis(), n = x.size();
+  GiNaC::lst bc = basis.get_basis();
+  sd.ndim = ndim; sd.n = n;
+
+  // Legendre degrees of each basis function
+  std::vector<std::vector<int> > deg(nb, std::vector<int>(ndim));
+  int maxdeg = 0;
+  for (int k=0; k<nb; ++k)
+    for (int d=0; d<ndim; ++d) {
+      deg[k][d] = bc[k].degree(basis.get_var(d));
+      maxdeg = std::max(maxdeg, deg[k][d]);
+    }
+
+  // 1D orthonormal functions and their values at the nodes
+  std::vector<GiNaC::symbol> v1 { basis.get_var(0) };
+  Gkyl::ModalBasis b1(Gkyl::MODAL_SER, 1, 0, v1, maxdeg);
+  GiNaC::lst bc1 = b1.get_basis();
+  sd.phi.assign(maxdeg+1, std::vector<GiNaC::ex>(n));
+  for (int a=0; a<=maxdeg; ++a)
+    for (int i=0; i<n; ++i)
+      sd.phi[a][i] = bc1[a].subs(basis.get_var(0) == x[i]).evalf();
+  for (size_t i=0; i<w.size(); ++i) sd.wt.push_back(w[i]);
+
+  // each basis function must be the product of the 1D functions
+  // (checked at a point with distinct coordinates)
+  for (int k=0; k<nb; ++k) {
+    GiNaC::exmap m;
+    GiNaC::ex prod = 1;
+    for (int d=0; d<ndim; ++d) {
+      GiNaC::numeric zd(d+2, 2*ndim+5);
+      m[basis.get_var(d)] = zd;
+      prod *= bc1[deg[k][d]].subs(basis.get_var(0) == zd);
+    }
+    GiNaC::ex diff = (bc[k].subs(m) - prod).evalf();
+    if (GiNaC::abs(GiNaC::ex_to<GiNaC::numeric>(diff)) > GiNaC::numeric(1, 1000000000)) {
+      std::cerr << "Basis function " << k << " is not a product of 1D Legendre polynomials" << std::endl;
+      std::exit(1);
+    }
+  }
+
+  sd.tails.resize(ndim+1);
+  sd.tidx.resize(ndim+1);
+  for (int d=0; d<=ndim; ++d)
+    for (int k=0; k<nb; ++k) {
+      std::vector<int> t(deg[k].begin()+d, deg[k].end());
+      if (sd.tidx[d].count(t) == 0) {
+        sd.tidx[d][t] = sd.tails[d].size();
+        sd.tails[d].push_back(t);
+      }
+    }
+  return sd;
+}
+
+// Name of array holding stage d
+static std::string
+stage_name(const sumfac_data &sd, int d, const std::string &in, const std::string &out, bool to_nodes)
+{
+  if (d == 0) return to_nodes ? in : out;
+  if (d == sd.ndim) return to_nodes ? out : in;
+  std::ostringstream s;
+  s << "sf" << d;
+  return s.str();
+}
+
+// Declares the intermediate stage arrays and opens a block for them
+static void
+open_stages(std::ostream &fc, const std::string &indent, const sumfac_data &sd)
+{
+  if (sd.ndim == 1) return;
+  fc << indent << "{" << std::endl;
+  fc << indent << "  double ";
+  for (int d=1, nq=sd.n; d<sd.ndim; ++d, nq*=sd.n)
+    fc << "sf" << d << "[" << nq*sd.tails[d].size() << "]" << (d<sd.ndim-1 ? ", " : ";");
+  fc << std::endl;
+}
+
+static void
+close_stages(std::ostream &fc, const std::string &indent, const sumfac_data &sd)
+{
+  if (sd.ndim > 1) fc << indent << "}" << std::endl;
+}
+
+// Writes lhs = expr and adds the ops to count
+static void
+write_stage_sum(std::ostream &fc, const std::string &indent, const std::string &lhs,
+  const GiNaC::ex &expr, struct gkyl_kern_op_count &count)
+{
+  fc << indent << lhs << " = " << GiNaC::csrc << expr << ";" << std::endl;
+  count = Gkyl::addOps(count, Gkyl::countOps(expr));
+}
+
+struct gkyl_kern_op_count
+Gkyl::writeTensorEval(std::ostream &fc, const std::string &indent, const ModalBasis &basis,
+  const std::vector<GiNaC::numeric> &x, const std::string &in, const std::string &out)
+{
+  struct gkyl_kern_op_count count = { 0 };
+  sumfac_data sd = calc_sumfac_data(basis, x, std::vector<GiNaC::numeric>());
+  int ndim = sd.ndim, n = sd.n;
+
+  open_stages(fc, indent, sd);
+  std::string ind = ndim > 1 ? indent + "  " : indent;
+
+  // contract the Legendre degree in direction d with the 1D values at
+  // the points in that direction
+  for (int d=0, nqd=1; d<ndim; ++d, nqd*=n) {
+    GiNaC::symbol src(stage_name(sd, d, in, out, true));
+    std::string dst = stage_name(sd, d+1, in, out, true);
+    int ns = sd.tails[d].size(), nt = sd.tails[d+1].size();
+    for (int qp=0; qp<nqd; ++qp)
+      for (int i=0; i<n; ++i)
+        for (int j=0; j<nt; ++j) {
+          GiNaC::ex e = 0;
+          for (size_t a=0; a<sd.phi.size(); ++a) {
+            std::vector<int> t(1, a);
+            t.insert(t.end(), sd.tails[d+1][j].begin(), sd.tails[d+1][j].end());
+            std::map<std::vector<int>, int>::const_iterator it = sd.tidx[d].find(t);
+            if (it != sd.tidx[d].end())
+              e += sd.phi[a][i]*GiNaC::indexed(src, GiNaC::idx(qp*ns+it->second, 1));
+          }
+          std::ostringstream lhs;
+          lhs << dst << "[" << (qp*n+i)*nt+j << "]";
+          write_stage_sum(fc, ind, lhs.str(), e, count);
+        }
+  }
+
+  close_stages(fc, indent, sd);
+  return count;
+}
+
+struct gkyl_kern_op_count
+Gkyl::writeQuadEval(std::ostream &fc, const std::string &indent, const ModalBasis &basis,
+  int n, const std::string &in, const std::string &out)
+{
+  std::vector<GiNaC::numeric> x, w;
+  Gkyl::quad1d(Gkyl::QUAD_GAUSS_LEGENDRE, n, x, w);
+  return writeTensorEval(fc, indent, basis, x, in, out);
+}
+
+struct gkyl_kern_op_count
+Gkyl::writeQuadProject(std::ostream &fc, const std::string &indent, const ModalBasis &basis,
+  int n, const std::string &in, const std::string &out)
+{
+  struct gkyl_kern_op_count count = { 0 };
+  std::vector<GiNaC::numeric> x, w;
+  Gkyl::quad1d(Gkyl::QUAD_GAUSS_LEGENDRE, n, x, w);
+  sumfac_data sd = calc_sumfac_data(basis, x, w);
+  int ndim = sd.ndim;
+
+  open_stages(fc, indent, sd);
+  std::string ind = ndim > 1 ? indent + "  " : indent;
+
+  // contract the nodes in direction d with the weighted 1D values,
+  // starting from the last direction
+  int nqd = 1;
+  for (int d=0; d<ndim-1; ++d) nqd *= n;
+  for (int d=ndim-1; d>=0; --d, nqd/=n) {
+    GiNaC::symbol src(stage_name(sd, d+1, in, out, false));
+    std::string dst = stage_name(sd, d, in, out, false);
+    int ns = sd.tails[d+1].size(), nt = sd.tails[d].size();
+    for (int qp=0; qp<nqd; ++qp)
+      for (int j=0; j<nt; ++j) {
+        int a = sd.tails[d][j][0];
+        std::vector<int> t(sd.tails[d][j].begin()+1, sd.tails[d][j].end());
+        int js = sd.tidx[d+1].find(t)->second;
+        GiNaC::ex e = 0;
+        for (int i=0; i<n; ++i)
+          e += sd.wt[i]*sd.phi[a][i]*GiNaC::indexed(src, GiNaC::idx((qp*n+i)*ns+js, 1));
+        std::ostringstream lhs;
+        lhs << dst << "[" << qp*nt+j << "]";
+        write_stage_sum(fc, ind, lhs.str(), e.evalf(), count);
+      }
+  }
+
+  close_stages(fc, indent, sd);
+  return count;
+}
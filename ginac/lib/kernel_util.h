@@ -0,0 +1,136 @@
+#pragma once
+
+#include <ostream>
+#include <string>
+#include <vector>
+#include <ginac/ginac.h>
+#include <gkyl_util.h>
+#include <modal_basis.h>
+#include <quadrature.h>
+
+namespace Gkyl {
+  /* Count number of sums and products needed to evaluate expression */
+  struct gkyl_kern_op_count countOps(const GiNaC::ex &expr);
+
+  /* Add two op counts */
+  struct gkyl_kern_op_count addOps(struct gkyl_kern_op_count c1, struct gkyl_kern_op_count c2);
+
+  /* Result of common subexpression elimination */
+  struct CSEResult {
+    GiNaC::lst temps; // expressions for temporaries tmp[0], tmp[1], ...
+    GiNaC::lst exprs; // input expressions written in terms of temporaries
+  };
+
+  /* Common subexpression elimination on a list of expressions that are
+     linear in the objects in 'over' (for example the coefficients of
+     the distribution function). Each expression is collected w.r.t
+     the objects in 'over' and coefficients that appear (up to a
+     numeric factor) in more than one place across all expressions are
+     replaced by temporaries tmp[n]. Pass exact (not evalf-ed)
+     expressions so that repeated coefficients compare equal. */
+  CSEResult cse(const GiNaC::lst &exprs, const GiNaC::lst &over, const GiNaC::symbol &tmp);
+
+  /* Write declaration (to fh) and definition (to fc) of function
+     op_count_name returning op counts of kernel 'name' */
+  void writeOpCount(std::ostream &fh, std::ostream &fc, const std::string &name,
+    struct gkyl_kern_op_count count);
+
+  /* Write static table name[n1][n2] of doubles with entries tab[i][j],
+     each line prefixed by indent */
+  void writeTable(std::ostream &fc, const std::string &indent, const std::string &name,
+    const std::vector<std::vector<GiNaC::ex> > &tab);
+
+  /* Write assignments name[k] = exprs[k], each line prefixed by
+     indent. Returns op count */
+  struct gkyl_kern_op_count writeAssign(std::ostream &fc, const std::string &indent,
+    const std::string &name, const GiNaC::lst &exprs);
+
+  /* Write out[l] += exprs[l] for non-zero expressions that are linear
+     in the objects in 'over'. Repeated coefficient combinations are
+     stored in tmp[]. Returns op count */
+  struct gkyl_kern_op_count writeIncrCSE(std::ostream &fc, const GiNaC::lst &exprs,
+    const GiNaC::lst &over);
+
+  /* Write the DG volume term out[l] += sum_d < db_l/dz_d, alpha[d]*f >
+     where alpha[d] is the expansion of the characteristic velocity
+     in direction d (zero if there is no flux in that direction). The
+     result is collected w.r.t. the coefficients of f and repeated
+     coefficient combinations are stored in tmp[]. Returns op count */
+  struct gkyl_kern_op_count writeVolTerm(std::ostream &fc, const ModalBasis &basis,
+    const std::vector<GiNaC::ex> &alpha, const GiNaC::symbol &f);
+
+  /* Expansion of a field in basis whose coefficients are stored in
+     array s starting at s[off*nb], nb the number of basis functions
+     (e.g. component off of a multi-component field) */
+  GiNaC::ex confExpand(const ModalBasis &basis, const GiNaC::symbol &s, int off);
+
+  /* Restriction of the expansion of f in basis to the face z_dir = zf */
+  GiNaC::ex faceExpand(const ModalBasis &basis, const GiNaC::symbol &f, int dir, int zf);
+
+  /* Projection of face function e on the surface basis sbasis. In 1D
+     the face is a point, sbasis is NULL and e itself is returned */
+  GiNaC::lst faceProject(const ModalBasis *sbasis, const GiNaC::ex &e);
+
+  /* Write projection of alpha on the surface basis into local array
+     alpha[k] and accumulate the bound sum_k |alpha[k]|*max|b_k| >=
+     |alpha| into amax (which must be declared by the caller). Returns
+     expansion of alpha in terms of alpha[k] and adds to count */
+  GiNaC::ex writeSurfAlpha(std::ostream &fc, const std::string &indent, const ModalBasis &sbasis,
+    const GiNaC::ex &alpha, struct gkyl_kern_op_count &count);
+
+  /* Lax-Friedrichs flux on the face between left state fm and right
+     state fp (both restricted to the face), projected on the surface
+     basis. The penalty uses the symbol amax */
+  GiNaC::lst calcLaxFlux(const ModalBasis &sbasis, const GiNaC::ex &alpha,
+    const GiNaC::ex &fm, const GiNaC::ex &fp);
+
+  /* Integral int_{-1}^{1} e dz of e polynomial in z. Other variables
+     are kept */
+  GiNaC::ex integrate1d(const GiNaC::ex &e, const GiNaC::ex &z);
+
+  /* Recovery polynomial across the face between a left cell with
+     expansion fl and a right cell with expansion fr in direction
+     dir. The returned g is a polynomial in z_dir, with the face at
+     z_dir = 0 and the left (right) cell occupying [-2,0] ([0,2]), whose
+     moments against 1, z, ..., z^p (p: degree of fl, fr in z_dir) in
+     each cell match those of fl and fr. Transverse dependence is kept */
+  GiNaC::ex recoverFace(const ModalBasis &basis, int dir, const GiNaC::ex &fl, const GiNaC::ex &fr);
+
+  /* Write the lift of surface fluxes Ghat_l (on face z_dir = -1) and
+     Ghat_r (on face z_dir = +1) into the volume coefficients out[],
+     out += b(z_dir=-1).Ghat_l - b(z_dir=+1).Ghat_r. Either face can be
+     skipped. Returns op count */
+  struct gkyl_kern_op_count writeLift(std::ostream &fc, const std::string &indent,
+    const ModalBasis &basis, const ModalBasis &sbasis, int dir, bool with_l, bool with_r);
+
+  /* Write assembly of the n x n system A.x = rhs into local arrays
+     A[n][n] and x[n] followed by a fully unrolled solve, leaving the
+     solution in x. If A is symbolically symmetric a Cholesky
+     factorization is used, skipping entries of the factor that are
+     structurally zero. Otherwise an LU factorization with partial
+     pivoting is used. Needs math.h. Returns op count */
+  struct gkyl_kern_op_count writeDenseSolve(std::ostream &fc, const std::string &indent,
+    const GiNaC::matrix &A, const GiNaC::lst &rhs);
+
+  /* Write sum-factorized evaluation of the expansion in basis with
+     coefficients in[] at the tensor product of the 1D points x,
+     storing the values in out[] (points ordered with the first
+     coordinate varying slowest). out must be declared by the
+     caller. Each basis function must be a product of 1D orthonormal
+     Legendre polynomials, as the serendipity and tensor basis
+     functions are. Returns op count */
+  struct gkyl_kern_op_count writeTensorEval(std::ostream &fc, const std::string &indent,
+    const ModalBasis &basis, const std::vector<GiNaC::numeric> &x, const std::string &in,
+    const std::string &out);
+
+  /* writeTensorEval at the nodes of the tensor Gauss-Legendre rule
+     with n points per direction */
+  struct gkyl_kern_op_count writeQuadEval(std::ostream &fc, const std::string &indent,
+    const ModalBasis &basis, int n, const std::string &in, const std::string &out);
+
+  /* Write the transpose of writeQuadEval with the weights folded in:
+     the projection out[k] = sum_q w_q b_k(x_q) in[q] of the values
+     in[] at the nodes onto basis. Returns op count */
+  struct gkyl_kern_op_count writeQuadProject(std::ostream &fc, const std::string &indent,
+    const ModalBasis &basis, int n, const std::string &in, const std::string &out);
+}
@@ -26,8 +26,8 @@ static struct { GiNaC::lst (*ev[4])(const std::vector<GiNaC::symbol>&);
 } ten_mo_list[] = {
   {NULL, NULL, NULL, NULL}, // No 0D basis functions
   {serendip_1x_p0, serendip_1x_p1, serendip_1x_p2, serendip_1x_p3},
-  {serendip_2x_p0, serendip_2x_p1, tensor_2x_p2, NULL},
-  {serendip_3x_p0, serendip_3x_p1, tensor_3x_p2, NULL},
+  {serendip_2x_p0, serendip_2x_p1, tensor_2x_p2, tensor_2x_p3},
+  {serendip_3x_p0, serendip_3x_p1, tensor_3x_p2, tensor_3x_p3},
   {serendip_4x_p0, serendip_4x_p1, tensor_4x_p2, NULL},
   {serendip_5x_p0, serendip_5x_p1, tensor_5x_p2, NULL},
   {serendip_6x_p0, serendip_6x_p1, NULL, NULL},
@@ -52,7 +52,7 @@ static struct { GiNaC::lst (*ev[4])(const std::vector<GiNaC::symbol>&);
 };
 
 Gkyl::ModalBasis::ModalBasis(ModalBasisType type, int ndim, int vdim, const std::vector<GiNaC::symbol>& invars, int polyOrder)
-: ndim(ndim), vdim(vdim), polyOrder(polyOrder)
+: type(type), ndim(ndim), vdim(vdim), polyOrder(polyOrder)
 {
   assert(ndim<=6 && polyOrder<=3);
 
@@ -60,28 +60,71 @@ Gkyl::ModalBasis::ModalBasis(ModalBasisType type, int ndim, int vdim, const std:
 
   if (type == Gkyl::MODAL_SER) {
     assert(ser_mo_list[ndim].ev[polyOrder] != NULL);
-    bc = gsOrthoNorm(ser_mo_list[ndim].ev[polyOrder](vars));
+    mo = ser_mo_list[ndim].ev[polyOrder](vars);
+    bc = gsOrthoNorm(mo);
   }
   else if (type == Gkyl::MODAL_TEN) {
     assert(ten_mo_list[ndim].ev[polyOrder] != NULL);
-    bc = gsOrthoNorm(ten_mo_list[ndim].ev[polyOrder](vars));
+    mo = ten_mo_list[ndim].ev[polyOrder](vars);
+    bc = gsOrthoNorm(mo);
   }
   else if (type == Gkyl::MODAL_HYB) {
     assert(vdim > 0 && vdim < ndim);
     assert(polyOrder == 1);
     int cdim = ndim-vdim;
     assert(hyb_mo_list[cdim].ev[vdim] != NULL);
-    bc = gsOrthoNorm(hyb_mo_list[cdim].ev[vdim](vars));
+    mo = hyb_mo_list[cdim].ev[vdim](vars);
+    bc = gsOrthoNorm(mo);
   }
   else if (type == Gkyl::MODAL_GKHYB) {
     assert(vdim > 0 && vdim < ndim);
     assert(polyOrder == 1);
     int cdim = ndim-vdim;
     assert(gkhyb_mo_list[cdim].ev[vdim] != NULL);
-    bc = gsOrthoNorm(gkhyb_mo_list[cdim].ev[vdim](vars));
+    mo = gkhyb_mo_list[cdim].ev[vdim](vars);
+    bc = gsOrthoNorm(mo);
   }  
 }
 
+Gkyl::ModalBasis::ModalBasis(ModalBasisType type, int ndim, int vdim, const std::vector<GiNaC::symbol>& invars, int polyOrder,
+  const GiNaC::lst& monomials)
+: type(type), ndim(ndim), vdim(vdim), polyOrder(polyOrder), mo(monomials)
+{
+  assert(ndim<=6);
+
+  for (int d=0; d<ndim; ++d) vars.push_back(invars[d]);
+  bc = gsOrthoNorm(mo);
+}
+
+Gkyl::ModalBasis
+Gkyl::ModalBasis::surfBasis(int n) const
+{
+  assert(ndim>1 && n<ndim);
+
+  std::vector<GiNaC::symbol> svars;
+  for (int d=0; d<ndim; ++d)
+    if (d != n) svars.push_back(vars[d]);
+
+  // serendipity and tensor bases restrict to the same family in one
+  // less dimension
+  if (type == Gkyl::MODAL_SER || type == Gkyl::MODAL_TEN)
+    return ModalBasis(type, ndim-1, 0, svars, polyOrder);
+
+  // hybrid bases: keep the monomials that survive on the surface, in
+  // order of first appearance
+  int svdim = n<ndim-vdim ? vdim : vdim-1;
+  GiNaC::exmap m; m[vars[n]] = 1;
+  GiNaC::lst smo;
+  for (auto midx = mo.begin(); midx != mo.end(); ++midx) {
+    GiNaC::ex sm = midx->subs(m);
+    bool found = false;
+    for (auto sidx = smo.begin(); sidx != smo.end(); ++sidx)
+      if (sm.is_equal(*sidx)) { found = true; break; }
+    if (!found) smo.append(sm);
+  }
+  return ModalBasis(type, ndim-1, svdim, svars, polyOrder, smo);
+}
+
 GiNaC::lst
 Gkyl::ModalBasis::get_vars() const
 {
@@ -101,14 +144,34 @@ Gkyl::ModalBasis::diffBasis(int n) const
 }
 
 GiNaC::ex
-Gkyl::ModalBasis::innerProd(const GiNaC::ex &f1, const GiNaC::ex &f2) const
+Gkyl::ModalBasis::integrate(const GiNaC::ex &f) const
 {
-  GiNaC::ex out = (f1*f2).expand();
-  for (int i=0; i<ndim; ++i)
-    out = GiNaC::integral(vars[i], -1, 1, out).eval_integ();
+  // non-polynomial integrands (e.g. from projections of functions) need
+  // symbolic integration
+  GiNaC::ex out = f.expand();
+  if (!out.is_polynomial(get_vars())) {
+    for (int i=0; i<ndim; ++i)
+      out = GiNaC::integral(vars[i], -1, 1, out).eval_integ();
+    return out;
+  }
+
+  // integrate term-by-term: int_{-1}^{1} x^k dx = 2/(k+1) for even k
+  // and 0 for odd k
+  for (int i=0; i<ndim; ++i) {
+    GiNaC::ex outi = 0;
+    for (int k=0; k<=out.degree(vars[i]); k+=2)
+      outi += out.coeff(vars[i], k)*GiNaC::numeric(2,k+1);
+    out = outi.expand();
+  }
   return out;
 }
 
+GiNaC::ex
+Gkyl::ModalBasis::innerProd(const GiNaC::ex &f1, const GiNaC::ex &f2) const
+{
+  return integrate((f1*f2).expand());
+}
+
 GiNaC::ex
 Gkyl::ModalBasis::norm(const GiNaC::ex &f) const
 {
@@ -157,4 +220,44 @@ Gkyl::ModalBasis::calcInnerProdList(const GiNaC::lst &lst, const GiNaC::ex &f) c
     out.append( innerProd(*lidx, f) );
   return out;
 }
-  
+
+GiNaC::lst
+Gkyl::ModalBasis::project(const GiNaC::ex &f) const
+{
+  // split f into monomials in the basis variables and their coefficients
+  std::map<GiNaC::ex, GiNaC::ex, GiNaC::ex_is_less> terms;
+  GiNaC::ex e = f.expand();
+  size_t nterms = GiNaC::is_a<GiNaC::add>(e) ? e.nops() : 1;
+  for (size_t n=0; n<nterms; ++n) {
+    GiNaC::ex t = GiNaC::is_a<GiNaC::add>(e) ? e.op(n) : e;
+    GiNaC::ex mono = 1, coef = 1;
+    size_t nf = GiNaC::is_a<GiNaC::mul>(t) ? t.nops() : 1;
+    for (size_t i=0; i<nf; ++i) {
+      GiNaC::ex fac = GiNaC::is_a<GiNaC::mul>(t) ? t.op(i) : t;
+      bool isvar = false;
+      for (int d=0; d<ndim; ++d)
+        if (fac.has(vars[d])) { isvar = true; break; }
+      if (isvar) mono *= fac; else coef *= fac;
+    }
+    terms[mono] += coef;
+  }
+
+  std::vector<GiNaC::ex> coeffs(bc.nops(), 0);
+  for (auto tidx = terms.begin(); tidx != terms.end(); ++tidx) {
+    if (tidx->second.is_zero()) continue;
+    auto mitr = momCache.find(tidx->first);
+    if (mitr == momCache.end()) {
+      GiNaC::lst mom;
+      for (auto bidx = bc.begin(); bidx != bc.end(); ++bidx)
+        mom.append( innerProd(tidx->first, *bidx) );
+      mitr = momCache.insert(std::make_pair(tidx->first, mom)).first;
+    }
+    for (size_t i=0; i<bc.nops(); ++i)
+      coeffs[i] += tidx->second*mitr->second[i];
+  }
+
+  GiNaC::lst out;
+  for (size_t i=0; i<bc.nops(); ++i)
+    out.append( coeffs[i].expand() );
+  return out;
+}
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <map>
 #include <vector>
 #include <ginac/ginac.h>
 
@@ -11,8 +12,12 @@ namespace Gkyl {
   public:
     /* Construct new modal basis object */
     ModalBasis(ModalBasisType type, int ndim, int vdim, const std::vector<GiNaC::symbol>& vars, int polyOrder);
+    /* Construct modal basis by orthonormalizing given list of monomials */
+    ModalBasis(ModalBasisType type, int ndim, int vdim, const std::vector<GiNaC::symbol>& vars, int polyOrder,
+      const GiNaC::lst& monomials);
     
-    /* Dimensions and polyorder */
+    /* Basis type, dimensions and polyorder */
+    ModalBasisType get_type() const { return type; }
     int get_ndim() const { return ndim; }
     int get_vdim() const { return vdim; }
     int get_polyOrder() const { return polyOrder; }
@@ -21,27 +26,47 @@ namespace Gkyl {
     int get_numbasis() const { return bc.nops(); }
     /* Get list of basis functions */
     GiNaC::lst get_basis() const { return bc; }
+    /* Get list of monomials the basis was constructed from */
+    GiNaC::lst get_monomials() const { return mo; }
     /* Get variables */
     GiNaC::lst get_vars() const;
     /* Return nth variable */
     const GiNaC::symbol& get_var(int n) const { return vars[n]; }
 
+    /* Get basis on the surface perpendicular to the n-th indep. var:
+       the basis is in the remaining ndim-1 variables. Only valid for
+       ndim>1 */
+    ModalBasis surfBasis(int n) const;
+
     /* Get derivative of basis functions wrt to n-th indep. var */
     GiNaC::lst diffBasis(int n) const;
 
     /* Generate indexed expansion with symbol 'f' and basis */
     GiNaC::ex expand(const GiNaC::symbol& f) const;
 
-    /* Compute inner product of f1 and f2 */
+    /* Compute inner product of f1 and f2 over [-1,1]^ndim. Polynomial
+       products are integrated term-by-term, others symbolically */
     GiNaC::ex innerProd(const GiNaC::ex &f1, const GiNaC::ex &f2) const;
 
     /* Calculate inner product with list of expressions */
     GiNaC::lst calcInnerProdList(const GiNaC::lst &lst, const GiNaC::ex &f) const;
 
+    /* Project polynomial f (in the basis variables) onto basis,
+       returning list of expansion coefficients. Moments of monomials
+       are cached, so repeated projections are cheap */
+    GiNaC::lst project(const GiNaC::ex &f) const;
+
   private:
+    ModalBasisType type;
     int ndim, vdim, polyOrder;
+    GiNaC::lst mo; // monomials basis is built from
     GiNaC::lst bc; // orthonormal basis set
     std::vector<GiNaC::symbol> vars; // Variable list
+    // cached inner products of monomials with basis functions
+    mutable std::map<GiNaC::ex, GiNaC::lst, GiNaC::ex_is_less> momCache;
+
+    /* Integrate f over [-1,1]^ndim */
+    GiNaC::ex integrate(const GiNaC::ex &f) const;
 
     /* Compute L2-norm of f */
     GiNaC::ex norm(const GiNaC::ex &f) const;
@@ -0,0 +1,54 @@
+#include <cassert>
+
+#include <nodal_basis.h>
+
+Gkyl::NodalBasis::NodalBasis(ModalBasisType type, int ndim, const std::vector<GiNaC::symbol>& vars, int polyOrder)
+: mbasis(type, ndim, 0, vars, polyOrder)
+{
+  assert((type == Gkyl::MODAL_SER || type == Gkyl::MODAL_TEN) && (polyOrder == 1 || polyOrder == 2));
+
+  // nodes on the lattice {-1,0,1}^ndim (only the corners for p=1);
+  // serendipity p=2 nodes have at most one zero coordinate
+  int npts = 1;
+  for (int d=0; d<ndim; ++d) npts *= 3;
+  for (int n=0; n<npts; ++n) {
+    std::vector<int> z(ndim);
+    int nzero = 0, r = n;
+    for (int d=ndim-1; d>=0; --d) {
+      z[d] = r%3-1; r /= 3;
+      if (z[d] == 0) nzero += 1;
+    }
+    if (polyOrder == 1 && nzero > 0) continue;
+    if (type == Gkyl::MODAL_SER && nzero > 1) continue;
+    nodes.push_back(z);
+  }
+
+  // Lagrange basis: b_k = sum_j mo_j c_jk with V.c = I, where
+  // V_ij = mo_j(node_i)
+  GiNaC::lst mo = mbasis.get_monomials();
+  int nb = mo.nops();
+  assert(nb == (int) nodes.size());
+  GiNaC::matrix V(nb, nb);
+  for (int i=0; i<nb; ++i) {
+    GiNaC::exmap m;
+    for (int d=0; d<ndim; ++d) m[mbasis.get_var(d)] = nodes[i][d];
+    for (int j=0; j<nb; ++j)
+      V(i,j) = mo[j].subs(m);
+  }
+  GiNaC::matrix c = V.inverse();
+  for (int k=0; k<nb; ++k) {
+    GiNaC::ex b = 0;
+    for (int j=0; j<nb; ++j)
+      b += mo[j]*c(j,k);
+    bc.append(b.expand());
+  }
+}
+
+GiNaC::lst
+Gkyl::NodalBasis::diffBasis(int n) const
+{
+  GiNaC::lst db;
+  for (auto bidx = bc.begin(); bidx != bc.end(); ++bidx)
+    db.append( GiNaC::diff(*bidx, get_var(n)) );
+  return db;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <vector>
+#include <ginac/ginac.h>
+#include <modal_basis.h>
+
+namespace Gkyl {
+  /* Lagrange (nodal) basis on [-1,1]^ndim spanning the same space as
+     the serendipity or tensor modal basis. Nodes are the corners for
+     p=1, corners and edge midpoints for serendipity p=2 and all points
+     of {-1,0,1}^ndim for tensor p=2 */
+  class NodalBasis {
+  public:
+    /* Construct new nodal basis object. Only MODAL_SER and MODAL_TEN
+       types with polyOrder 1 or 2 are supported */
+    NodalBasis(ModalBasisType type, int ndim, const std::vector<GiNaC::symbol>& vars, int polyOrder);
+
+    /* Basis type, dimensions and polyorder */
+    ModalBasisType get_type() const { return mbasis.get_type(); }
+    int get_ndim() const { return mbasis.get_ndim(); }
+    int get_polyOrder() const { return mbasis.get_polyOrder(); }
+
+    /* Get number of basis functions (= number of nodes) */
+    int get_numbasis() const { return bc.nops(); }
+    /* Get list of basis functions: basis function k is 1 at node k
+       and 0 at all other nodes */
+    GiNaC::lst get_basis() const { return bc; }
+    /* Coordinates (-1, 0 or 1) of the nodes, ordered
+       lexicographically with the first coordinate varying slowest */
+    const std::vector<std::vector<int> >& get_nodes() const { return nodes; }
+    /* Return nth variable */
+    const GiNaC::symbol& get_var(int n) const { return mbasis.get_var(n); }
+    /* Modal basis spanning the same space */
+    const ModalBasis& get_modal() const { return mbasis; }
+
+    /* Get derivative of basis functions wrt to n-th indep. var */
+    GiNaC::lst diffBasis(int n) const;
+
+    /* Compute inner product of f1 and f2 */
+    GiNaC::ex innerProd(const GiNaC::ex &f1, const GiNaC::ex &f2) const { return mbasis.innerProd(f1, f2); }
+
+  private:
+    ModalBasis mbasis; // modal basis with the same span
+    GiNaC::lst bc; // nodal basis set
+    std::vector<std::vector<int> > nodes; // node coordinates
+  };
+}
@@ -0,0 +1,253 @@
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <set>
+
+#include <kernel_util.h>
+#include <quadrature.h>
+
+using namespace GiNaC;
+
+// Convert double to a float at the current working precision, so that
+// subsequent Newton iterations are not limited to double precision
+static numeric
+to_float(double x)
+{
+  return ex_to<numeric>(ex(numeric(long(std::floor(x*1e15+0.5)), 1000000000000000L)).evalf());
+}
+
+int
+Gkyl::QuadRule::findNode(const std::vector<numeric>& node) const
+{
+  numeric tol = numeric(1, 1000000000);
+  for (size_t i=0; i<nodes.size(); ++i) {
+    bool same = true;
+    for (int d=0; d<ndim && same; ++d)
+      if (abs(nodes[i][d]-node[d]) > tol) same = false;
+    if (same) return i;
+  }
+  return -1;
+}
+
+int
+Gkyl::QuadRule::addNode(const std::vector<numeric>& node, const numeric& wt)
+{
+  int i = findNode(node);
+  if (i >= 0) {
+    weights[i] = weights[i] + wt;
+    return i;
+  }
+  pushNode(node, wt);
+  return nodes.size()-1;
+}
+
+bool
+Gkyl::QuadRule::isExact(const lst& monos, const std::vector<symbol>& vars) const
+{
+  int nq = nodes.size(), nm = monos.nops();
+  std::vector<std::vector<int> > pw(nm, std::vector<int>(ndim));
+  int maxdeg = 0;
+  for (int m=0; m<nm; ++m)
+    for (int d=0; d<ndim; ++d) {
+      pw[m][d] = monos[m].degree(vars[d]);
+      maxdeg = std::max(maxdeg, pw[m][d]);
+    }
+
+  // powers of node coordinates
+  std::vector<std::vector<std::vector<numeric> > > xp(nq,
+    std::vector<std::vector<numeric> >(ndim, std::vector<numeric>(maxdeg+1)));
+  for (int q=0; q<nq; ++q)
+    for (int d=0; d<ndim; ++d) {
+      xp[q][d][0] = 1;
+      for (int k=1; k<=maxdeg; ++k) xp[q][d][k] = xp[q][d][k-1]*nodes[q][d];
+    }
+
+  numeric tol = numeric(1, 1000000000)*numeric(1, 1000000000);
+  for (int m=0; m<nm; ++m) {
+    // exact integral of monomial over [-1,1]^ndim
+    numeric exact = 1;
+    for (int d=0; d<ndim; ++d)
+      exact = pw[m][d]%2 == 1 ? numeric(0) : exact*numeric(2, pw[m][d]+1);
+
+    numeric sum = 0;
+    for (int q=0; q<nq; ++q) {
+      numeric v = weights[q];
+      for (int d=0; d<ndim; ++d) v = v*xp[q][d][pw[m][d]];
+      sum = sum + v;
+    }
+    if (abs(sum-exact) > tol) return false;
+  }
+  return true;
+}
+
+void
+Gkyl::QuadRule::writeTables(std::ostream& fc, const std::string& indent, const std::string& name) const
+{
+  int nq = nodes.size();
+  std::vector<std::vector<ex> > tab(nq, std::vector<ex>(ndim));
+  for (int q=0; q<nq; ++q)
+    for (int d=0; d<ndim; ++d) tab[q][d] = nodes[q][d];
+  Gkyl::writeTable(fc, indent, name + "_nodes", tab);
+
+  fc << indent << "static const double " << name << "_weights[" << nq << "] = { ";
+  for (int q=0; q<nq; ++q)
+    fc << csrc << ex(weights[q]).evalf() << (q<nq-1 ? ", " : "");
+  fc << " };" << std::endl;
+}
+
+void
+Gkyl::quad1d(QuadType type, int n, std::vector<numeric>& x, std::vector<numeric>& wt)
+{
+  x.resize(n); wt.resize(n);
+  numeric tol = numeric(1, 1000000000)*numeric(1, 1000000000);
+
+  if (type == QUAD_GAUSS_LEGENDRE) {
+    // Newton iterations on P_n
+    for (int i=0; i<n; ++i) {
+      numeric xi = to_float(std::cos(M_PI*(i+0.75)/(n+0.5)));
+      numeric dp;
+      for (int it=0; it<100; ++it) {
+        // P_n(xi) and P_n'(xi) from the three-term recurrence
+        numeric p0 = 1, p1 = xi;
+        for (int k=2; k<=n; ++k) {
+          numeric p2 = (numeric(2*k-1)*xi*p1 - numeric(k-1)*p0)/numeric(k);
+          p0 = p1; p1 = p2;
+        }
+        dp = numeric(n)*(xi*p1 - p0)/(xi*xi - numeric(1));
+        numeric dx = p1/dp;
+        xi = xi - dx;
+        if (abs(dx) < tol) break;
+      }
+      x[i] = xi;
+      wt[i] = numeric(2)/((numeric(1) - xi*xi)*dp*dp);
+    }
+  }
+  else {
+    // interior nodes are the zeros of P_N', N = n-1, found with Newton
+    // iterations on x P_N - P_{N-1} = (x^2-1) P_N'/N
+    assert(n >= 2);
+    int N = n-1;
+    for (int i=0; i<n; ++i) {
+      numeric xi = i == 0 ? numeric(1) : (i == N ? numeric(-1) : to_float(std::cos(M_PI*i/N)));
+      numeric p0, p1;
+      for (int it=0; it<100; ++it) {
+        p0 = 1; p1 = xi;
+        for (int k=2; k<=N; ++k) {
+          numeric p2 = (numeric(2*k-1)*xi*p1 - numeric(k-1)*p0)/numeric(k);
+          p0 = p1; p1 = p2;
+        }
+        if (i == 0 || i == N) break;
+        numeric dx = (xi*p1 - p0)/(numeric(n)*p1);
+        xi = xi - dx;
+        if (abs(dx) < tol) break;
+      }
+      x[i] = xi;
+      wt[i] = numeric(2)/(numeric(N*n)*p1*p1);
+    }
+  }
+}
+
+Gkyl::QuadRule
+Gkyl::tensorQuad(QuadType type, int ndim, int n)
+{
+  std::vector<numeric> x, wt;
+  quad1d(type, n, x, wt);
+
+  int nq = 1;
+  for (int d=0; d<ndim; ++d) nq *= n;
+
+  QuadRule q(ndim);
+  for (int m=0; m<nq; ++m) {
+    std::vector<numeric> node(ndim);
+    numeric w = 1;
+    for (int d=ndim-1, r=m; d>=0; --d) {
+      node[d] = x[r%n]; w = w*wt[r%n];
+      r /= n;
+    }
+    q.pushNode(node, w);
+  }
+  return q;
+}
+
+// Q = sum_{level-ndim+1 <= |i| <= level} (-1)^(level-|i|) binomial(ndim-1, level-|i|) Q_i1 x ... x Q_ind
+Gkyl::QuadRule
+Gkyl::sparseQuad(int ndim, int level)
+{
+  int nmax = level-ndim+1;
+  std::vector<std::vector<numeric> > x(nmax+1), wt(nmax+1);
+  for (int n=1; n<=nmax; ++n)
+    quad1d(QUAD_GAUSS_LEGENDRE, n, x[n], wt[n]);
+
+  QuadRule q(ndim);
+  std::vector<int> i(ndim, 1);
+  while (true) {
+    int s = 0;
+    for (int d=0; d<ndim; ++d) s += i[d];
+    if (s >= level-ndim+1 && s <= level) {
+      numeric c = binomial(numeric(ndim-1), numeric(level-s));
+      if ((level-s)%2 == 1) c = -c;
+
+      // tensor product of the 1D rules i[0], ..., i[ndim-1]
+      std::vector<int> j(ndim, 0);
+      while (true) {
+        std::vector<numeric> node(ndim);
+        numeric w = c;
+        for (int d=0; d<ndim; ++d) {
+          node[d] = x[i[d]][j[d]];
+          w = w*wt[i[d]][j[d]];
+        }
+        q.addNode(node, w);
+        int d = 0;
+        while (d<ndim && ++j[d] == i[d]) j[d++] = 0;
+        if (d == ndim) break;
+      }
+    }
+    int d = 0;
+    while (d<ndim && ++i[d] > nmax) i[d++] = 1;
+    if (d == ndim) break;
+  }
+  return q;
+}
+
+lst
+Gkyl::productMonomials(const lst& a, const lst& b)
+{
+  std::set<ex, ex_is_less> prods;
+  lst out;
+  for (size_t i=0; i<a.nops(); ++i)
+    for (size_t j=0; j<b.nops(); ++j) {
+      ex m = (a[i]*b[j]).expand();
+      if (prods.insert(m).second) out.append(m);
+    }
+  return out;
+}
+
+Gkyl::QuadRule
+Gkyl::exactQuad(int ndim, const lst& monos, const std::vector<symbol>& vars)
+{
+  // the tensor rule is exact if it is in each direction
+  int n = 1, tdeg = 0;
+  for (size_t m=0; m<monos.nops(); ++m) {
+    int deg = 0;
+    for (int d=0; d<ndim; ++d) {
+      int dd = monos[m].degree(vars[d]);
+      n = std::max(n, dd/2+1);
+      deg += dd;
+    }
+    tdeg = std::max(tdeg, deg);
+  }
+  QuadRule best = tensorQuad(QUAD_GAUSS_LEGENDRE, ndim, n);
+
+  // sparse grids are exact for total degree 2*(level-ndim)+1 but may
+  // integrate the given monomials exactly at lower levels. Their size
+  // grows with level, so stop once they are larger than the best rule
+  for (int level=ndim; level<=ndim+tdeg/2; ++level) {
+    QuadRule sq = sparseQuad(ndim, level);
+    if (sq.get_numnodes() >= best.get_numnodes()) break;
+    if (sq.isExact(monos, vars)) {
+      best = sq;
+      break;
+    }
+  }
+  return best;
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <ostream>
+#include <string>
+#include <vector>
+#include <ginac/ginac.h>
+
+namespace Gkyl {
+  /* Types of 1D rules from which tensor rules are built */
+  enum QuadType { QUAD_GAUSS_LEGENDRE, QUAD_GAUSS_LOBATTO };
+
+  /* Quadrature rule on [-1,1]^ndim. Nodes and weights are computed at
+     the current GiNaC working precision (Digits), which should be set
+     well beyond double precision before constructing rules */
+  class QuadRule {
+  public:
+    /* Construct empty rule */
+    QuadRule(int ndim) : ndim(ndim) { }
+
+    /* Dimensions and number of nodes */
+    int get_ndim() const { return ndim; }
+    int get_numnodes() const { return weights.size(); }
+
+    /* Node coordinates and weights */
+    const std::vector<std::vector<GiNaC::numeric> >& get_nodes() const { return nodes; }
+    const std::vector<GiNaC::numeric>& get_weights() const { return weights; }
+
+    /* Index of node at the given location, or -1 if there is none */
+    int findNode(const std::vector<GiNaC::numeric>& node) const;
+
+    /* Add node with weight, merging with an existing node at the same
+       location. Returns index of node */
+    int addNode(const std::vector<GiNaC::numeric>& node, const GiNaC::numeric& wt);
+
+    /* Add node with weight without looking for an existing node at the
+       same location */
+    void pushNode(const std::vector<GiNaC::numeric>& node, const GiNaC::numeric& wt) {
+      nodes.push_back(node);
+      weights.push_back(wt);
+    }
+
+    /* True if the rule integrates all the monomials in monos (in the
+       variables vars) exactly */
+    bool isExact(const GiNaC::lst& monos, const std::vector<GiNaC::symbol>& vars) const;
+
+    /* Write static tables name_nodes[nq][ndim] and name_weights[nq],
+       each line prefixed by indent */
+    void writeTables(std::ostream& fc, const std::string& indent, const std::string& name) const;
+
+  private:
+    int ndim; // number of dimensions
+    std::vector<std::vector<GiNaC::numeric> > nodes; // node coordinates
+    std::vector<GiNaC::numeric> weights; // weights
+  };
+
+  /* 1D rule with n points on [-1,1], nodes in decreasing order. The
+     Gauss-Legendre rule is exact for degree 2n-1 and the
+     Gauss-Lobatto rule (n >= 2, includes the end points) for degree
+     2n-3 */
+  void quad1d(QuadType type, int n, std::vector<GiNaC::numeric>& x, std::vector<GiNaC::numeric>& wt);
+
+  /* Tensor-product rule with n points per direction. Nodes are ordered
+     lexicographically with the first coordinate varying slowest */
+  QuadRule tensorQuad(QuadType type, int ndim, int n);
+
+  /* Smolyak sparse grid built from Gauss-Legendre rules of 1, 2, ...
+     points using the combination technique. It integrates polynomials
+     of total degree 2*(level-ndim)+1 exactly. Weights can be negative
+     and coincident nodes are merged */
+  QuadRule sparseQuad(int ndim, int level);
+
+  /* Distinct products a_i*b_j of the monomials in a and b (for
+     example the monomials of the mass matrix of a basis) */
+  GiNaC::lst productMonomials(const GiNaC::lst& a, const GiNaC::lst& b);
+
+  /* Cheapest of the tensor Gauss-Legendre and sparse-grid rules that
+     integrates all the monomials in monos exactly */
+  QuadRule exactQuad(int ndim, const GiNaC::lst& monos, const std::vector<GiNaC::symbol>& vars);
+}
@@ -0,0 +1,121 @@
+#include <acutest.h>
+#include <quadrature.h>
+#include <modal_basis.h>
+
+void
+test_lobatto_1d()
+{
+  using namespace GiNaC;
+  Digits = 32;
+
+  std::vector<numeric> x, wt;
+  Gkyl::quad1d(Gkyl::QUAD_GAUSS_LOBATTO, 3, x, wt);
+
+  numeric tol = numeric(1, 1000000000)*numeric(1, 1000000000);
+  TEST_CHECK( x.size() == 3 );
+  TEST_CHECK( abs(x[0]-1) < tol && abs(x[1]) < tol && abs(x[2]+1) < tol );
+  TEST_CHECK( abs(wt[0]-numeric(1,3)) < tol && abs(wt[1]-numeric(4,3)) < tol );
+}
+
+void
+test_tensor_exact()
+{
+  using namespace GiNaC;
+  Digits = 32;
+
+  symbol x("x"), y("y"), z("z");
+  std::vector<symbol> vars { x, y, z };
+  Gkyl::QuadRule q = Gkyl::tensorQuad(Gkyl::QUAD_GAUSS_LEGENDRE, 3, 2);
+
+  TEST_CHECK( q.get_numnodes() == 8 );
+  TEST_CHECK( q.isExact(lst{1, pow(x,3)*pow(y,2)*z, pow(y,3)}, vars) );
+  TEST_CHECK( !q.isExact(lst{pow(x,4)}, vars) );
+}
+
+void
+test_sparse_exact()
+{
+  using namespace GiNaC;
+  Digits = 32;
+
+  symbol z0("z0"), z1("z1"), z2("z2"), z3("z3"), z4("z4");
+  std::vector<symbol> vars { z0, z1, z2, z3, z4 };
+  lst monos = { 1, pow(z0,2), z1*z2*z3, pow(z4,3), pow(z2,2)*z3 };
+
+  // total degree 3 in 5D needs fewer nodes than the 2^5 tensor rule
+  Gkyl::QuadRule q = Gkyl::sparseQuad(5, 6);
+  TEST_CHECK( q.get_numnodes() < 32 );
+  TEST_CHECK( q.isExact(monos, vars) );
+
+  Gkyl::QuadRule eq = Gkyl::exactQuad(5, monos, vars);
+  TEST_CHECK( eq.get_numnodes() == q.get_numnodes() );
+}
+
+// Projection of f on basis functions bc using rule q
+static std::vector<GiNaC::numeric>
+project(const Gkyl::QuadRule& q, const GiNaC::lst& bc, const GiNaC::ex& f,
+  const std::vector<GiNaC::symbol>& vars)
+{
+  using namespace GiNaC;
+  std::vector<numeric> out(bc.nops(), 0);
+  for (int n=0; n<q.get_numnodes(); ++n) {
+    exmap m;
+    for (int d=0; d<q.get_ndim(); ++d) m[vars[d]] = q.get_nodes()[n][d];
+    numeric fn = ex_to<numeric>(f.subs(m).evalf());
+    for (size_t k=0; k<bc.nops(); ++k)
+      out[k] = out[k] + q.get_weights()[n]*fn*ex_to<numeric>(bc[k].subs(m).evalf());
+  }
+  return out;
+}
+
+void
+test_maxwellian_mass_exact()
+{
+  using namespace GiNaC;
+  Digits = 32;
+
+  // 2x3v p1 Maxwellian with drift varying linearly in x
+  symbol z0("z0"), z1("z1"), z2("z2"), z3("z3"), z4("z4");
+  std::vector<symbol> vars { z0, z1, z2, z3, z4 };
+  Gkyl::ModalBasis basis(Gkyl::MODAL_SER, 5, 0, vars, 1);
+  lst bc = basis.get_basis();
+  ex ux = numeric(3,10) + numeric(1,5)*z0;
+  ex f = exp(-(pow(z2-ux,2) + pow(z3,2) + pow(z4,2))/2);
+
+  // basis function proportional to x*vx
+  int kxv = -1;
+  for (size_t k=0; k<bc.nops(); ++k)
+    if (bc[k].degree(z0) == 1 && bc[k].degree(z2) == 1 && bc[k].degree(z1) == 0
+      && bc[k].degree(z3) == 0 && bc[k].degree(z4) == 0) kxv = k;
+  TEST_CHECK( kxv >= 0 );
+
+  lst monos = Gkyl::productMonomials(basis.get_monomials(), basis.get_monomials());
+
+  // level pdim+1 sparse grid: the x*vx coefficient is lost
+  Gkyl::QuadRule sq = Gkyl::sparseQuad(5, 6);
+  TEST_CHECK( !sq.isExact(monos, vars) );
+  numeric tol = numeric(1, 1000000000)*numeric(1, 1000);
+  TEST_CHECK( abs(project(sq, bc, f, vars)[kxv]) < tol );
+
+  // no sparse grid smaller than the tensor rule is exact for the mass
+  // matrix, so the cheapest mass-exact rule is the 2^5 tensor rule
+  for (int level=5; ; ++level) {
+    Gkyl::QuadRule lq = Gkyl::sparseQuad(5, level);
+    if (lq.get_numnodes() >= 32) break;
+    TEST_CHECK( !lq.isExact(monos, vars) );
+  }
+  Gkyl::QuadRule eq = Gkyl::exactQuad(5, monos, vars);
+  Gkyl::QuadRule tq = Gkyl::tensorQuad(Gkyl::QUAD_GAUSS_LEGENDRE, 5, 2);
+  TEST_CHECK( eq.get_numnodes() == tq.get_numnodes() );
+  for (int n=0; n<tq.get_numnodes(); ++n)
+    TEST_CHECK( eq.findNode(tq.get_nodes()[n]) >= 0 );
+  TEST_CHECK( abs(project(eq, bc, f, vars)[kxv]) > numeric(1, 1000) );
+}
+
+TEST_LIST = {
+  { "lobatto_1d", test_lobatto_1d },
+  { "tensor_exact", test_tensor_exact },
+  { "sparse_exact", test_sparse_exact },
+  { "maxwellian_mass_exact", test_maxwellian_mass_exact },
+  { NULL, NULL },
+};